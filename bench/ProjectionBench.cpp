@@ -0,0 +1,53 @@
+// Per-simplex overhead of slicing through the virtual Visualizer4 interface
+// against the statically dispatched Project<SolidVisualizer>.
+
+#include "forth.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Forth;
+
+template <class V>
+static double Run(CrossSection &projector, const Buffer4 &source, Buffer3 &dest, V *viz, int frames, int *crossing)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int f = 0; f < frames; f++)
+	{
+		// Sweep the slice so every frame crosses a different set of simplices
+		const Transform4 view = Transform4::Position(Vector4(0, 0, 0, (f % 64) / 64.f - 0.5f));
+		viz->Initialize(dest);
+		projector.Project(source, view, viz);
+		viz->End();
+		*crossing += dest.indices_count / 3;
+	}
+
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	const int subdivision = argc > 1 ? atoi(argv[1]) : 16;
+	const int frames = argc > 2 ? atoi(argv[2]) : 256;
+
+	Buffer4 source;
+	MeshGen::MakeHypersphere(source, subdivision);
+
+	CrossSection projector;
+	SolidVisualizer solid;
+	Buffer3 dest;
+
+	// Warm up caches and output capacity
+	int ignored = 0;
+	Run(projector, source, dest, &solid, 8, &ignored);
+
+	int dynamic = 0, templated = 0;
+	const double virtualNs = Run(projector, source, dest, (Visualizer4 *)&solid, frames, &dynamic);
+	const double staticNs = Run(projector, source, dest, &solid, frames, &templated);
+
+	printf("%d simplices, %d frames\n", source.indiceCount / 4, frames);
+	printf("Project(Visualizer4 *)     %8.2f ms/frame %6.2f ns/triangle\n", virtualNs / frames * 1e-6, virtualNs / Max(dynamic, 1));
+	printf("Project<SolidVisualizer>   %8.2f ms/frame %6.2f ns/triangle\n", staticNs / frames * 1e-6, staticNs / Max(templated, 1));
+	return 0;
+}
@@ -0,0 +1,183 @@
+// Marching the adjacency table reaches the same crossing simplices as scanning all of them.
+
+#include "Check.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Forth;
+
+static uint32_t seed = 4242;
+
+static uint32_t Random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static float Random(float min, float max)
+{
+	return min + (max - min) * ((Random() >> 8) / 16777216.f);
+}
+
+// Kuhn triangulation of an n^3 grid of cubes sharing their vertices, W being linear over the grid
+// so that any W slice is one connected piece
+static void Tetrahedrons(Buffer4 &buffer, int n, const Vector4 &slope)
+{
+	static const int permutations[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+	buffer.Clear();
+	buffer.simplex = SM_Tetrahedron;
+
+	for (int x = 0; x <= n; x++)
+		for (int y = 0; y <= n; y++)
+			for (int z = 0; z <= n; z++)
+				buffer.AddVertex(Vector4(x + Random(-0.2f, 0.2f), y + Random(-0.2f, 0.2f), z + Random(-0.2f, 0.2f),
+										 slope.x * x + slope.y * y + slope.z * z));
+
+	for (int x = 0; x < n; x++)
+		for (int y = 0; y < n; y++)
+			for (int z = 0; z < n; z++)
+				for (auto &p : permutations)
+				{
+					int c[3] = {x, y, z}, ids[4];
+					for (int k = 0; k < 4; k++)
+					{
+						if (k > 0)
+							c[p[k - 1]]++;
+						ids[k] = (c[0] * (n + 1) + c[1]) * (n + 1) + c[2];
+					}
+					buffer.AddSimplex(ids[0], ids[1], ids[2], ids[3]);
+				}
+}
+
+// Simplex starts crossing W = cut, by scanning every simplex
+static std::vector<int> Scan(const Buffer4 &buffer, float cut)
+{
+	std::vector<int> result;
+	for (int i = 0; i < buffer.indiceCount; i += 4)
+	{
+		int s = 0;
+		for (int j = 0; j < 4; j++)
+			s += buffer.vertices[buffer.indices[i + j]].w > cut;
+		if (s > 0 && s < 4)
+			result.push_back(i);
+	}
+	return result;
+}
+
+static std::vector<int> March(const Buffer4 &buffer, float cut, const std::vector<int> &seeds)
+{
+	std::vector<int> result;
+	buffer.adjacency->March(
+		buffer.indices, seeds.data(), (int)seeds.size(), [&](int v) { return buffer.vertices[v].w > cut; },
+		[&](int i) { result.push_back(i); });
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+// Output vertices rounded and sorted, so different gather orders compare equal
+static std::vector<std::vector<long>> Points(const Buffer3 &buffer)
+{
+	std::vector<std::vector<long>> result;
+	for (int i = 0; i < buffer.vertices_count; i++)
+		result.push_back({lround(buffer.vertices[i].x * 1e4f), lround(buffer.vertices[i].y * 1e4f),
+						  lround(buffer.vertices[i].z * 1e4f)});
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+static void CheckMarch(void)
+{
+	Buffer4 buffer;
+
+	for (int trial = 0; trial < 20; trial++)
+	{
+		const Vector4 slope(Random(-1, 1), Random(-1, 1), Random(-1, 1), 0);
+		Tetrahedrons(buffer, 5, slope);
+		buffer.SetAdjacency(false);
+		buffer.SetAdjacency(true);
+
+		// Grid interior faces are all matched, leaving 2 triangles per cube face on the outside
+		CHECK_EQUAL(buffer.adjacency->BoundaryCount(), 6 * 5 * 5 * 2);
+
+		for (int level = 0; level < 5; level++)
+		{
+			const float cut = Random(-2, 2);
+			const std::vector<int> scan = Scan(buffer, cut);
+
+			if (scan.empty())
+			{
+				CHECK(March(buffer, cut, {0}).empty());
+				continue;
+			}
+
+			// One crossing seed reaches every crossing simplex, each visited once
+			CHECK(March(buffer, cut, {scan[scan.size() / 2]}) == scan);
+
+			// Seeding everything gives the same set
+			std::vector<int> all;
+			for (int i = 0; i < buffer.indiceCount; i += 4)
+				all.push_back(i);
+			CHECK(March(buffer, cut, all) == scan);
+
+			// Seeds away from the slice are skipped
+			int away = -1;
+			for (int i = 0; i < buffer.indiceCount && away < 0; i += 4)
+				if (!std::binary_search(scan.begin(), scan.end(), i))
+					away = i;
+			if (away >= 0)
+				CHECK(March(buffer, cut, {away}).empty());
+		}
+	}
+}
+
+static void CheckCrossSection(void)
+{
+	Buffer4 buffer;
+	Tetrahedrons(buffer, 6, Vector4(0.3f, -0.5f, 0.7f, 0));
+	buffer.SetAdjacency(true);
+
+	CrossSection section, marched;
+	section.SetViewMatrix(Transform4(Vector4(), Matrix4(1)));
+	marched.SetViewMatrix(Transform4(Vector4(), Matrix4(1)));
+
+	for (int level = 0; level < 10; level++)
+	{
+		const float cut = Random(-3, 4);
+		const std::vector<int> scan = Scan(buffer, cut);
+		const Transform4 transform(Vector4(0, 0, 0, -cut), Matrix4(1));
+
+		Buffer3 expected, actual;
+		section.Project(buffer, transform, expected);
+
+		marched.seeds.assign(1, scan.empty() ? 0 : scan.back());
+		marched.Project(buffer, transform, actual);
+
+		CHECK_EQUAL(actual.vertices_count, expected.vertices_count);
+		CHECK_EQUAL(actual.indices_count, expected.indices_count);
+		CHECK(Points(actual) == Points(expected));
+	}
+
+	// Appended simplices are picked up by the marched slice too
+	const int count = buffer.indiceCount;
+	buffer.AddSimplex(buffer.indices[0], buffer.indices[1], buffer.indices[2], buffer.AddVertex(Vector4(-1, 0, 0, 1)));
+	CHECK_EQUAL(buffer.adjacency->indices, count);
+
+	Buffer3 expected, actual;
+	const Transform4 transform(Vector4(0, 0, 0, -0.01f), Matrix4(1));
+	section.Project(buffer, transform, expected);
+	marched.seeds.assign(1, Scan(buffer, 0.01f)[0]);
+	marched.Project(buffer, transform, actual);
+
+	CHECK_EQUAL(buffer.adjacency->indices, buffer.indiceCount);
+	CHECK(Points(actual) == Points(expected));
+}
+
+int main(void)
+{
+	CheckMarch();
+	CheckCrossSection();
+	return CheckResult();
+}
@@ -0,0 +1,62 @@
+// Steady-state projections must never touch the heap, see SetAllocationHook().
+
+#include "Check.h"
+#include <atomic>
+
+using namespace Forth;
+
+static std::atomic<int> allocations(0);
+
+static void Count(size_t) { allocations++; }
+
+// Project the same view twice, the second one must reuse everything from the first
+template <class B>
+static int SecondFrameAllocations(CrossSection &projector, const Buffer4 &source, B &dest)
+{
+	const Transform4 view = Transform4::Position(Vector4(0, 0, 0, 0.1f));
+	projector.Project(source, view, dest);
+
+	allocations = 0;
+	projector.Project(source, view, dest);
+	return allocations;
+}
+
+int main(void)
+{
+	Buffer4 source;
+	MeshGen::MakeHypersphere(source, 8);
+
+	SetAllocationHook(Count);
+
+	for (int threads : {1, 4})
+	{
+		for (bool weld : {false, true})
+		{
+			CrossSection projector;
+			projector.threads = threads;
+			projector.weld = weld;
+			projector.parallelThreshold = 64;
+
+			Buffer3 buffer;
+			BufferGL gl;
+			CHECK_EQUAL(SecondFrameAllocations(projector, source, buffer), 0);
+			CHECK_EQUAL(SecondFrameAllocations(projector, source, gl), 0);
+			CHECK(buffer.indices_count > 0);
+		}
+	}
+
+	// Thread creation is reported too
+	{
+		CrossSection projector;
+		projector.threads = 4;
+		projector.parallelThreshold = 64;
+		Buffer3 buffer;
+
+		allocations = 0;
+		projector.Project(source, Transform4::Position(Vector4(0, 0, 0, 0.1f)), buffer);
+		CHECK(allocations >= 3);
+	}
+
+	SetAllocationHook(NULL);
+	return CheckResult();
+}
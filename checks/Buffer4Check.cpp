@@ -0,0 +1,189 @@
+// Buffer4 mesh rewrites keep the same simplices, up to vertex renumbering and simplex order.
+
+#include "Check.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Forth;
+
+static uint32_t seed = 99;
+
+static uint32_t Random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static float Jitter(float amount)
+{
+	return amount * ((Random() >> 8) / 8388608.f - 1);
+}
+
+// Every simplex as the positions of its vertices in order, rounded to the grid, sorted
+static std::vector<std::vector<int>> Simplices(const Buffer4 &buffer, float grid)
+{
+	const int stride = buffer.simplex + 1;
+	std::vector<std::vector<int>> result;
+
+	for (int i = 0; i + stride <= buffer.indiceCount; i += stride)
+	{
+		std::vector<int> s;
+		for (int j = 0; j < stride; j++)
+		{
+			const Vector4 &v = buffer.vertices[buffer.indices[i + j]];
+			for (int a = 0; a < 4; a++)
+				s.push_back((int)lround(v[a] / grid));
+		}
+		result.push_back(s);
+	}
+
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+// Kuhn triangulation of an n^3 grid of cubes (w = 0), each tetrahedron given its own vertex copies
+static void Tetrahedrons(Buffer4 &buffer, int n, float spacing, float jitter)
+{
+	static const int permutations[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+	buffer.Clear();
+	buffer.simplex = SM_Tetrahedron;
+
+	for (int x = 0; x < n; x++)
+		for (int y = 0; y < n; y++)
+			for (int z = 0; z < n; z++)
+				for (auto &p : permutations)
+				{
+					int c[3] = {x, y, z}, ids[4];
+					for (int k = 0; k < 4; k++)
+					{
+						if (k > 0)
+							c[p[k - 1]]++;
+						ids[k] = buffer.AddVertex(Vector4(c[0] * spacing + Jitter(jitter), c[1] * spacing + Jitter(jitter),
+														  c[2] * spacing + Jitter(jitter), Jitter(jitter)));
+					}
+					buffer.AddTrimid(ids[0], ids[1], ids[2], ids[3]);
+				}
+}
+
+static int Duplicates(const Buffer4 &buffer)
+{
+	std::vector<std::vector<float>> v;
+	for (int i = 0; i < buffer.verticeCount; i++)
+		v.push_back({buffer.vertices[i].x, buffer.vertices[i].y, buffer.vertices[i].z, buffer.vertices[i].w});
+	std::sort(v.begin(), v.end());
+	return (int)v.size() - (int)(std::unique(v.begin(), v.end()) - v.begin());
+}
+
+static void CheckWeld(void)
+{
+	const int n = 4, grid = (n + 1) * (n + 1) * (n + 1);
+	Buffer4 buffer;
+
+	// Exact copies
+	Tetrahedrons(buffer, n, 1, 0);
+	const std::vector<std::vector<int>> before = Simplices(buffer, 1);
+	CHECK_EQUAL(buffer.Weld(), n * n * n * 24 - grid);
+	CHECK_EQUAL(buffer.verticeCount, grid);
+	CHECK_EQUAL(Duplicates(buffer), 0);
+	CHECK(Simplices(buffer, 1) == before);
+
+	// Copies apart by less than tolerance, far from their neighbours
+	Tetrahedrons(buffer, n, 1, 0.01f);
+	CHECK_EQUAL(buffer.Weld(0.05f), n * n * n * 24 - grid);
+	CHECK(Simplices(buffer, 1) == before);
+
+	// Too far apart to weld
+	Tetrahedrons(buffer, n, 1, 0.01f);
+	CHECK_EQUAL(buffer.Weld(0.0001f), 0);
+	CHECK_EQUAL(buffer.verticeCount, n * n * n * 24);
+
+	// Simplices collapsing into repeated vertices are dropped
+	Tetrahedrons(buffer, 1, 1, 0);
+	buffer.AddVertex(Vector4(0, 0, 0, 0));
+	buffer.AddVertex(Vector4(1, 0, 0, 0));
+	buffer.AddVertex(Vector4(0, 0, 0, 0));
+	buffer.AddVertex(Vector4(0, 1, 0, 0));
+	buffer.AddTrimid(24, 25, 26, 27);
+	const std::vector<std::vector<int>> cube = Simplices(buffer, 1);
+	buffer.Weld();
+	CHECK_EQUAL(buffer.verticeCount, 8);
+	CHECK_EQUAL(buffer.indiceCount, 6 * 4);
+	std::vector<std::vector<int>> kept = Simplices(buffer, 1);
+	CHECK(kept.size() == 6 && std::includes(cube.begin(), cube.end(), kept.begin(), kept.end()));
+}
+
+// Shuffle simplex order and vertex numbering, so the mesh starts cache unfriendly
+static void Shuffle(Buffer4 &buffer)
+{
+	const int stride = buffer.simplex + 1, count = buffer.indiceCount / stride;
+	std::vector<int> order(count), numbers(buffer.verticeCount);
+	for (int i = 0; i < count; i++)
+		order[i] = i;
+	for (int i = 0; i < buffer.verticeCount; i++)
+		numbers[i] = i;
+	for (int i = count - 1; i > 0; i--)
+		std::swap(order[i], order[Random() % (i + 1)]);
+	for (int i = buffer.verticeCount - 1; i > 0; i--)
+		std::swap(numbers[i], numbers[Random() % (i + 1)]);
+
+	const std::vector<int> indices(buffer.indices, buffer.indices + buffer.indiceCount);
+	const std::vector<Vector4> vertices(buffer.vertices, buffer.vertices + buffer.verticeCount);
+	for (int i = 0; i < count; i++)
+		for (int j = 0; j < stride; j++)
+			buffer.indices[i * stride + j] = numbers[indices[order[i] * stride + j]];
+	for (int i = 0; i < buffer.verticeCount; i++)
+		buffer.vertices[numbers[i]] = vertices[i];
+}
+
+static void CheckOptimize(void)
+{
+	Buffer4 buffer;
+	Tetrahedrons(buffer, 8, 1, 0);
+	buffer.Weld();
+	Shuffle(buffer);
+
+	const std::vector<std::vector<int>> before = Simplices(buffer, 1);
+	const int vertices = buffer.verticeCount;
+
+	for (int cacheSize : {32, 16, 8})
+	{
+		const float ratio = buffer.CacheMissRatio(cacheSize);
+		const float optimized = buffer.Optimize(cacheSize);
+
+		CHECK(optimized <= ratio);
+		CHECK(optimized == buffer.CacheMissRatio(cacheSize));
+		CHECK_EQUAL(buffer.verticeCount, vertices);
+		CHECK(Simplices(buffer, 1) == before);
+	}
+
+	// Shuffled meshes miss on nearly every vertex, a grid reordered should reuse most of them
+	Shuffle(buffer);
+	CHECK(buffer.CacheMissRatio() > 2);
+	CHECK(buffer.Optimize() < 1);
+
+	// Already optimized, it doesn't get worse
+	const float ratio = buffer.CacheMissRatio();
+	CHECK(buffer.Optimize() <= ratio);
+	CHECK(Simplices(buffer, 1) == before);
+
+	// Vertices are renumbered by first use
+	int next = 0, late = 0;
+	std::vector<bool> seen(buffer.verticeCount, false);
+	for (int i = 0; i < buffer.indiceCount; i++)
+	{
+		const int v = buffer.indices[i];
+		if (!seen[v])
+			late += v != next++, seen[v] = true;
+	}
+	CHECK_EQUAL(late, 0);
+}
+
+int main(void)
+{
+	CheckWeld();
+	CheckOptimize();
+	return CheckResult();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Minimal assertion helpers shared by the self-check executables.
+
+#include "forth.h"
+#include <cstdio>
+
+static int checkFailures = 0;
+
+#define CHECK(cond)                                                       \
+	do                                                                    \
+	{                                                                     \
+		if (!(cond))                                                      \
+		{                                                                 \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			checkFailures++;                                              \
+		}                                                                 \
+	} while (0)
+
+#define CHECK_EQUAL(a, b)                                                                          \
+	do                                                                                             \
+	{                                                                                              \
+		long long _a = (long long)(a), _b = (long long)(b);                                        \
+		if (_a != _b)                                                                              \
+		{                                                                                          \
+			printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+			checkFailures++;                                                                       \
+		}                                                                                          \
+	} while (0)
+
+static int CheckResult(void)
+{
+	if (checkFailures == 0)
+		printf("all checks passed\n");
+	return checkFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+// Frustum4 clipping keeps every emitted vertex inside of all frustum planes.
+
+#include "Check.h"
+#include <vector>
+
+using namespace Forth;
+
+// Keeps every polygon as given, in view space while perspectiveness is zero
+class CaptureVisualizer : public Visualizer4
+{
+  public:
+	std::vector<std::vector<Vector4>> polygons;
+
+	void Initialize(Buffer3 & /*buffer*/) override { polygons.clear(); }
+
+	void Render(const Vector4 buffer[], int count) override
+	{
+		polygons.push_back(std::vector<Vector4>(buffer, buffer + count));
+	}
+};
+
+static unsigned seed = 12345;
+
+static float Random(float min, float max)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return min + (max - min) * ((seed >> 8) / 16777216.f);
+}
+
+static Vector4 RandomPoint(void)
+{
+	return Vector4(Random(-4, 4), Random(-4, 4), Random(-4, 4), Random(-3, 6));
+}
+
+static bool IsInside(const Frustum4 &frustum, const Vector4 &p)
+{
+	const float tolerance = 1e-4f * (1 + Abs(p.x) + Abs(p.y) + Abs(p.z) + Abs(p.w));
+	for (int plane = 0; plane < 8; plane++)
+		if (frustum.GetDistance(plane, p) > tolerance)
+			return false;
+	return true;
+}
+
+// Count emitted vertices outside of any plane
+static int Outside(Frustum4 &frustum, const Buffer4 &buffer, CaptureVisualizer &capture)
+{
+	Buffer3 unused;
+	capture.Initialize(unused);
+	frustum.Project(buffer, Transform4(Vector4(), Matrix4(1)), (Visualizer4 *)&capture);
+
+	int outside = 0;
+	for (auto &polygon : capture.polygons)
+		for (auto &p : polygon)
+			outside += !IsInside(frustum, p);
+	return outside;
+}
+
+static void Setup(Frustum4 &frustum)
+{
+	frustum.farClip = 5;
+	frustum.perspectiveness = 0;
+	frustum.Setup();
+	frustum.SetViewMatrix(Transform4(Vector4(), Matrix4(1)));
+}
+
+static void CheckTriangles(void)
+{
+	Frustum4 frustum;
+	Setup(frustum);
+	CaptureVisualizer capture;
+	Buffer4 buffer;
+	buffer.simplex = SM_Triangle;
+
+	// One vertex behind the eye, which is outside of both planes of every axis
+	buffer.AddVertex(Vector4(0, 0, 0, -1));
+	buffer.AddVertex(Vector4(0.9f, 0, 0, 1));
+	buffer.AddVertex(Vector4(0, 0.5f, 0, 1));
+	buffer.AddTriangle(0, 1, 2);
+	CHECK_EQUAL(Outside(frustum, buffer, capture), 0);
+	CHECK_EQUAL((int)capture.polygons.size(), 1);
+
+	buffer.Clear();
+	for (int i = 0; i < 3000; i++)
+		buffer.AddVertex(RandomPoint());
+	for (int i = 0; i < 3000; i += 3)
+		buffer.AddTriangle(i, i + 1, i + 2);
+	CHECK_EQUAL(Outside(frustum, buffer, capture), 0);
+	CHECK(capture.polygons.size() > 0);
+}
+
+static void CheckTetrahedrons(void)
+{
+	Frustum4 frustum;
+	Setup(frustum);
+	CaptureVisualizer capture;
+	Buffer4 buffer;
+	buffer.simplex = SM_Tetrahedron;
+
+	// Straddling the near plane, with one vertex behind the eye
+	buffer.AddVertex(Vector4(0, 0, 0, -1));
+	buffer.AddVertex(Vector4(0.9f, 0, 0, 1));
+	buffer.AddVertex(Vector4(0, 0.5f, 0, 1));
+	buffer.AddVertex(Vector4(0, 0, 0.5f, 2));
+	buffer.AddTrimid(0, 1, 2, 3);
+	CHECK_EQUAL(Outside(frustum, buffer, capture), 0);
+	// Clipped faces and at least the near cap
+	CHECK(capture.polygons.size() >= 4);
+
+	buffer.Clear();
+	for (int i = 0; i < 4000; i++)
+		buffer.AddVertex(RandomPoint());
+	for (int i = 0; i < 4000; i += 4)
+		buffer.AddTrimid(i, i + 1, i + 2, i + 3);
+	CHECK_EQUAL(Outside(frustum, buffer, capture), 0);
+	CHECK(capture.polygons.size() > 0);
+}
+
+// Count faces wound against the orientation of the only tetrahedron in the buffer
+static int Flipped(Frustum4 &frustum, const Buffer4 &buffer, CaptureVisualizer &capture)
+{
+	Outside(frustum, buffer, capture);
+
+	const Vector4 *v = buffer.vertices;
+	const int *t = buffer.indices;
+	const Vector4 normal = Cross(v[t[1]] - v[t[0]], v[t[2]] - v[t[0]], v[t[3]] - v[t[0]]);
+	Vector4 center = Vector4();
+	int points = 0, flipped = 0;
+
+	for (auto &polygon : capture.polygons)
+		for (auto &p : polygon)
+			center += p, points++;
+	center /= (float)Max(points, 1);
+
+	for (auto &polygon : capture.polygons)
+		flipped += Frustum4::IsFlipped(polygon.data(), (int)polygon.size(), normal, center);
+	return flipped;
+}
+
+static void CheckWinding(void)
+{
+	Frustum4 frustum;
+	Setup(frustum);
+	CaptureVisualizer capture;
+	Buffer4 buffer;
+	buffer.simplex = SM_Tetrahedron;
+
+	for (int i = 0; i < 500; i++)
+	{
+		buffer.Clear();
+		for (int j = 0; j < 4; j++)
+			buffer.AddVertex(i % 2 ? RandomPoint() : Vector4(Random(-1, 1), Random(-1, 1), Random(-1, 1), Random(2, 4)));
+
+		// Both windings, either inside of the frustum or clipped
+		buffer.AddTrimid(0, 1, 2, 3);
+		CHECK_EQUAL(Flipped(frustum, buffer, capture), 0);
+
+		buffer.indices[0] = 1;
+		buffer.indices[1] = 0;
+		CHECK_EQUAL(Flipped(frustum, buffer, capture), 0);
+	}
+}
+
+int main(void)
+{
+	CheckTriangles();
+	CheckTetrahedrons();
+	CheckWinding();
+	return CheckResult();
+}
@@ -0,0 +1,273 @@
+// Binary mesh files and OBJ text parsing, against the standard library and across chunks.
+
+#include "Check.h"
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Forth;
+
+static uint32_t seed = 4321;
+
+// Xorshift, all 32 bits are usable
+static uint32_t Random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static bool SameFloat(float a, float b)
+{
+	return (std::isnan(a) && std::isnan(b)) || memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// Parse every token as the first coordinate of its own vertex, compare with strtof
+static void CheckFloats(const std::vector<std::string> &tokens)
+{
+	std::string text;
+	for (const std::string &t : tokens)
+		text += "v " + t + " 0 0 0\n";
+
+	Buffer4 buffer;
+	CHECK(ReadMeshOBJ(text.data(), text.size(), buffer, 1));
+	CHECK_EQUAL(buffer.verticeCount, (int)tokens.size());
+
+	int mismatches = 0;
+	for (int i = 0; i < buffer.verticeCount && i < (int)tokens.size(); i++)
+	{
+		const float expected = strtof(tokens[i].c_str(), NULL);
+		if (!SameFloat(buffer.vertices[i].x, expected))
+		{
+			if (mismatches++ < 8)
+				printf("parsed %s as %.9g, expected %.9g\n", tokens[i].c_str(), buffer.vertices[i].x, expected);
+		}
+	}
+	CHECK_EQUAL(mismatches, 0);
+}
+
+static void CheckParseFloat(void)
+{
+	std::vector<std::string> tokens = {
+		// Plain, signed and exponent forms
+		"0", "-0", "+1", "1.5", "-2.25", ".5", "5.", "1e3", "1E-3", "-7.5e+2", "123456789", "0.000001",
+		// Exactly halfway between two floats, ties to even
+		"16777217", "16777219", "1.000000059604644775390625", "0.50000002980232238769531250",
+		// Longer mantissas than 19 digits
+		"1.00000000000000000000001", "3.14159265358979323846264338327950288",
+		"123456789012345678901234567890", "0.000000000000000000000000000000123456789012345678901234567890",
+		// Exponents beyond exact powers of ten, denormals, overflow and underflow
+		"1e23", "1e-23", "3.4028234e38", "3.4028236e38", "1e39", "1.17549435e-38", "1e-40", "1.4e-45", "1e-50",
+		// Left to the standard library
+		"inf", "-inf", "nan", "INFINITY", "0x1p4"};
+
+	// Decimals around the midpoint of random neighbouring floats, printed with more and more digits
+	for (int i = 0; i < 20000; i++)
+	{
+		float f;
+		const uint32_t bits = Random() % 0x7F000000u;
+		memcpy(&f, &bits, sizeof(f));
+		const double mid = ((double)f + (double)nextafterf(f, INFINITY)) / 2;
+
+		char s[64];
+		snprintf(s, sizeof(s), "%.*g", 6 + i % 15, mid);
+		tokens.push_back(s);
+	}
+
+	// Short decimals nearest to the midpoint, which the fast path reads into a double lying exactly halfway
+	for (int i = 0; i < 20000; i++)
+	{
+		float f;
+		const uint32_t bits = 0x0C000000u + Random() % 0x66000000u;
+		memcpy(&f, &bits, sizeof(f));
+		const long double mid = ((long double)f + (long double)nextafterf(f, INFINITY)) / 2;
+
+		// Scale the midpoint into 16 digits, then round it to an integer mantissa
+		const int k = 15 - (int)floorl(log10l(mid));
+		if (k < -22 || k > 22)
+			continue;
+		const long long m = llroundl(mid * powl(10.0L, (long double)k));
+
+		char s[64];
+		for (int d = -1; d <= 1; d++)
+		{
+			snprintf(s, sizeof(s), "%llde%d", m + d, -k);
+			tokens.push_back(s);
+		}
+	}
+
+	CheckFloats(tokens);
+}
+
+// Written with enough digits for floats to survive, so parsing must restore them exactly
+static void CheckOBJRoundTrip(void)
+{
+	Model4 model;
+	Buffer4 &input = model.input;
+	input.simplex = SM_Tetrahedron;
+
+	// Text past a few megabytes, so it's split into as many chunks as threads
+	for (int i = 0; i < 80000; i++)
+	{
+		float f[4];
+		for (int j = 0; j < 4; j++)
+		{
+			const uint32_t bits = 0x30000000u + Random() % 0x1F000000u;
+			memcpy(f + j, &bits, sizeof(float));
+			f[j] = Random() & 1 ? -f[j] : f[j];
+		}
+		input.AddVertex(Vector4(f[0], f[1], f[2], f[3]));
+	}
+	for (int i = 0; i < 80000; i += 4)
+		input.AddTrimid(i, i + 1, i + 2, i + 3);
+
+	std::stringstream stream;
+	stream.precision(9);
+	model.WriteStreamOBJ(stream);
+	const std::string text = stream.str();
+	CHECK(text.size() > (4 << 20));
+
+	for (int threads = 1; threads <= 4; threads += 3)
+	{
+		Buffer4 parsed;
+		CHECK(ReadMeshOBJ(text.data(), text.size(), parsed, threads));
+		CHECK_EQUAL(parsed.simplex, SM_Tetrahedron);
+		CHECK_EQUAL(parsed.verticeCount, input.verticeCount);
+		CHECK_EQUAL(parsed.indiceCount, input.indiceCount);
+
+		if (parsed.verticeCount == input.verticeCount && parsed.indiceCount == input.indiceCount)
+		{
+			CHECK(memcmp(parsed.vertices, input.vertices, input.verticeCount * sizeof(Vector4)) == 0);
+			CHECK(memcmp(parsed.indices, input.indices, input.indiceCount * sizeof(int)) == 0);
+		}
+	}
+
+	// Faces disagreeing across chunks are rejected too
+	const std::string mixed = text + "f 0 1 2\n";
+	Buffer4 parsed;
+	CHECK(!ReadMeshOBJ(mixed.data(), mixed.size(), parsed, 4));
+}
+
+static std::string WriteFile(const Buffer4 &source, const Transform4 *transform = NULL, bool bounds = true)
+{
+	std::stringstream stream;
+	CHECK(WriteMeshFile(stream, source, transform, bounds));
+	return stream.str();
+}
+
+static void CheckFileRoundTrip(void)
+{
+	Buffer4 source;
+	source.simplex = SM_Tetrahedron;
+	for (int i = 0; i < 103; i++)
+		source.AddVertex(Vector4((float)i, (float)(i % 7), -(float)i, 1.f / (i + 1)));
+	for (int i = 0; i + 3 < 103; i += 2)
+		source.AddTrimid(i, i + 1, i + 2, i + 3);
+
+	const std::string file = WriteFile(source);
+	MeshFileHeader h;
+	memcpy(&h, file.data(), sizeof(h));
+	CHECK_EQUAL(h.vertexOffset % 16, 0);
+	CHECK_EQUAL(h.indexOffset % 16, 0);
+	CHECK(h.flags & MF_Bounds);
+
+	Buffer4 read;
+	SphereBounds4 bounds;
+	CHECK(ReadMeshFile(file.data(), file.size(), read, &bounds));
+	CHECK_EQUAL(read.simplex, SM_Tetrahedron);
+	CHECK_EQUAL(read.verticeCount, source.verticeCount);
+	CHECK_EQUAL(read.indiceCount, source.indiceCount);
+	if (read.verticeCount == source.verticeCount && read.indiceCount == source.indiceCount)
+	{
+		CHECK(memcmp(read.vertices, source.vertices, source.verticeCount * sizeof(Vector4)) == 0);
+		CHECK(memcmp(read.indices, source.indices, source.indiceCount * sizeof(int)) == 0);
+	}
+
+	// Bounds hold every vertex
+	int outside = 0;
+	for (int i = 0; i < source.verticeCount; i++)
+		outside += Distance(bounds.center, source.vertices[i]) > bounds.radius * 1.0001f;
+	CHECK_EQUAL(outside, 0);
+
+	// Transformed on the way out
+	const Transform4 shift = Transform4::Position(Vector4(1, 2, 3, 4));
+	const std::string moved = WriteFile(source, &shift, false);
+	CHECK(ReadMeshFile(moved.data(), moved.size(), read));
+	CHECK(read.verticeCount == source.verticeCount && read.vertices[5] == shift * source.vertices[5]);
+
+	// Points have no index block to speak of
+	Buffer4 points;
+	points.simplex = SM_Point;
+	points.AddVertex(Vector4(1, 2, 3, 4));
+	points.AddPoint(0);
+	const std::string single = WriteFile(points);
+	CHECK(ReadMeshFile(single.data(), single.size(), read));
+	CHECK(read.simplex == SM_Point && read.verticeCount == 1 && read.indiceCount == 1);
+}
+
+// Reading must fail and leave nothing behind
+static bool Rejected(const std::string &file, size_t size)
+{
+	Buffer4 read;
+	return !ReadMeshFile(file.data(), size, read) && read.verticeCount == 0 && read.indiceCount == 0;
+}
+
+static void CheckFileRejects(void)
+{
+	Buffer4 source;
+	source.simplex = SM_Triangle;
+	for (int i = 0; i < 9; i++)
+		source.AddVertex(Vector4((float)i, 0, 0, 1));
+	source.AddTriangle(0, 1, 2);
+	source.AddTriangle(3, 4, 8);
+
+	const std::string file = WriteFile(source);
+	MeshFileHeader h;
+	memcpy(&h, file.data(), sizeof(h));
+
+	// Truncated anywhere: within the header, the vertex block or the index block
+	CHECK(Rejected(file, 0));
+	CHECK(Rejected(file, sizeof(MeshFileHeader) - 1));
+	CHECK(Rejected(file, (size_t)h.vertexOffset + 4));
+	CHECK(Rejected(file, file.size() - 1));
+
+	// Indices past the last vertex, or negative
+	for (int bad : {9, 1 << 30, -1})
+	{
+		std::string broken = file;
+		memcpy(&broken[(size_t)h.indexOffset + 5 * sizeof(int)], &bad, sizeof(int));
+		CHECK(Rejected(broken, broken.size()));
+	}
+
+	// Header fields out of range
+	auto patched = [&](void (*patch)(MeshFileHeader &)) {
+		std::string broken = file;
+		MeshFileHeader p = h;
+		patch(p);
+		memcpy(&broken[0], &p, sizeof(p));
+		return Rejected(broken, broken.size());
+	};
+	CHECK(patched([](MeshFileHeader &p) { p.magic[0] = 'X'; }));
+	CHECK(patched([](MeshFileHeader &p) { p.version++; }));
+	CHECK(patched([](MeshFileHeader &p) { p.simplex = 4; }));
+	CHECK(patched([](MeshFileHeader &p) { p.indexCount--; }));
+	CHECK(patched([](MeshFileHeader &p) { p.vertexCount = 1ULL << 40; }));
+	CHECK(patched([](MeshFileHeader &p) { p.indexOffset = ~0ULL - 8; }));
+	CHECK(patched([](MeshFileHeader &p) { p.vertexOffset = p.indexOffset; }));
+
+	// Intact, it still reads
+	Buffer4 read;
+	CHECK(ReadMeshFile(file.data(), file.size(), read));
+}
+
+int main(void)
+{
+	CheckFileRoundTrip();
+	CheckFileRejects();
+	CheckParseFloat();
+	CheckOBJRoundTrip();
+	return CheckResult();
+}
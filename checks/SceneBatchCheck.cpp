@@ -0,0 +1,139 @@
+// SceneBatch grouping, ranges and index rebasing, without any GL context.
+
+#include "Check.h"
+
+using namespace Forth;
+
+// Driver of given amount of quads (two triangles each), indexed or not, with or without normals
+static void Fill(BufferGL &driver, int quads, bool indexed, bool normals)
+{
+	driver.generate.indexed = indexed;
+	driver.generate.normal = normals;
+	driver.Setup(SM_Triangle);
+
+	for (int q = 0; q < quads; q++)
+	{
+		const float x = (float)q;
+		if (indexed)
+		{
+			int v[4];
+			v[0] = driver.AddVertex(Vector3(x, 0, 0));
+			v[1] = driver.AddVertex(Vector3(x + 1, 0, 0));
+			v[2] = driver.AddVertex(Vector3(x + 1, 1, 0));
+			v[3] = driver.AddVertex(Vector3(x, 1, 0));
+			driver.AddPolygon(v, 4, Vector3(0, 0, 1));
+		}
+		else
+		{
+			for (int i = 0; i < 6; i++)
+				driver.AddVertex(Vector3(x, (float)i, 0));
+		}
+	}
+
+	driver.Pack();
+}
+
+static int Index(const BufferGL &buffer, int i)
+{
+	if (buffer.attr.indexSize == 2)
+	{
+		unsigned short s;
+		memcpy(&s, (const char *)buffer.ib + i * sizeof(s), sizeof(s));
+		return s;
+	}
+	return (int)buffer.ib[i];
+}
+
+static const SceneBatch::Group *GroupOf(const SceneBatch &batch, const Model4 *model)
+{
+	for (int i = 0; i < batch.GroupCount(); i++)
+		for (Model4 *m : batch.GetGroup(i).models)
+			if (m == model)
+				return &batch.GetGroup(i);
+	return NULL;
+}
+
+int main(void)
+{
+	Model4 a, b, c, d, empty;
+	Fill(a.driver, 2, true, true);
+	Fill(b.driver, 3, true, true);
+	Fill(c.driver, 1, true, false);
+	Fill(d.driver, 2, false, true);
+	empty.driver.Setup(SM_Triangle);
+
+	SceneBatch batch;
+	const std::vector<Model4 *> models = {&a, &c, &empty, &b, &d};
+
+	// Built twice, the second one reusing storage of the first
+	for (int pass = 0; pass < 2; pass++)
+	{
+		CHECK_EQUAL(batch.Build(models), 3);
+		CHECK(GroupOf(batch, &empty) == NULL);
+
+		// Indexed with normals: a then b, b's indices rebased past a's vertices
+		const SceneBatch::Group *ab = GroupOf(batch, &a);
+		CHECK(ab != NULL && ab == GroupOf(batch, &b));
+		if (ab)
+		{
+			CHECK_EQUAL(ab->Ranges(), 2);
+			CHECK(ab->models[0] == &a && ab->models[1] == &b);
+			CHECK_EQUAL(ab->firsts[0], 0);
+			CHECK_EQUAL(ab->counts[0], a.driver.attr.indexs);
+			CHECK_EQUAL(ab->firsts[1], a.driver.attr.indexs);
+			CHECK_EQUAL(ab->counts[1], b.driver.attr.indexs);
+			CHECK_EQUAL(ab->buffer.attr.vertexs, a.driver.attr.vertexs + b.driver.attr.vertexs);
+			CHECK_EQUAL(ab->buffer.attr.indexSize, 2);
+			CHECK((size_t)ab->offsets[1] == (size_t)a.driver.attr.indexs * 2);
+
+			int rebased = 0;
+			for (int i = 0; i < b.driver.attr.indexs; i++)
+				rebased += Index(ab->buffer, a.driver.attr.indexs + i) == Index(b.driver, i) + a.driver.attr.vertexs;
+			CHECK_EQUAL(rebased, b.driver.attr.indexs);
+			CHECK(memcmp(ab->buffer.vb, a.driver.vb, a.driver.vb_count * sizeof(float)) == 0);
+		}
+
+		// Indexed without normals: a group of its own
+		const SceneBatch::Group *gc = GroupOf(batch, &c);
+		CHECK(gc != NULL && gc != ab);
+		if (gc)
+		{
+			CHECK_EQUAL(gc->Ranges(), 1);
+			CHECK_EQUAL(gc->counts[0], c.driver.attr.indexs);
+			CHECK_EQUAL(gc->buffer.attr.slots, 1);
+		}
+
+		// Not indexed: ranges are in vertices
+		const SceneBatch::Group *gd = GroupOf(batch, &d);
+		CHECK(gd != NULL && gd != ab && gd != gc);
+		if (gd)
+		{
+			CHECK_EQUAL(gd->Ranges(), 1);
+			CHECK_EQUAL(gd->firsts[0], 0);
+			CHECK_EQUAL(gd->counts[0], 12);
+			CHECK(!gd->buffer.IsIndexed());
+		}
+	}
+
+	// Quantized positions are relative to their own bounds, so only equal bounds share a group
+	std::vector<Model4> quantized(64);
+	std::vector<Model4 *> shifted;
+	for (int i = 0; i < (int)quantized.size(); i++)
+	{
+		BufferGL &driver = quantized[i].driver;
+		driver.generate.positionFormat = AF_Short;
+		Fill(driver, 1 + i % 2, true, true);
+		shifted.push_back(&quantized[i]);
+	}
+
+	CHECK_EQUAL(batch.Build(shifted), 2);
+	CHECK(GroupOf(batch, shifted[0]) == GroupOf(batch, shifted[2]));
+	CHECK(GroupOf(batch, shifted[0]) != GroupOf(batch, shifted[1]));
+	CHECK_EQUAL(GroupOf(batch, shifted[1])->Ranges(), 32);
+
+	for (int i = 0; i < (int)quantized.size(); i++)
+		Fill(quantized[i].driver, 1 + i, true, true);
+	CHECK_EQUAL(batch.Build(shifted), (int)quantized.size());
+
+	return CheckResult();
+}
@@ -0,0 +1,160 @@
+// SceneTree inserts, removals, moves and culling queries, against a brute-force scan.
+
+#include "Check.h"
+#include <vector>
+
+using namespace Forth;
+
+static uint32_t seed = 777;
+
+static float Random(float min, float max)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return min + (max - min) * ((seed >> 8) / 16777216.f);
+}
+
+static Bounds4 RandomBox(void)
+{
+	const Vector4 c(Random(-50, 50), Random(-50, 50), Random(-50, 50), Random(-50, 50));
+	const Vector4 e(Random(0.1f, 4), Random(0.1f, 4), Random(0.1f, 4), Random(0.1f, 4));
+	return Bounds4(c - e, c + e);
+}
+
+// Inner bounds lie within outer ones, faces may touch
+static bool Within(const Bounds4 &outer, const Bounds4 &inner)
+{
+	for (int i = 0; i < 4; i++)
+		if (inner.min[i] < outer.min[i] || inner.max[i] > outer.max[i])
+			return false;
+	return true;
+}
+
+// Culls whatever lies entirely beyond a plane, which a sphere test gets exactly
+class PlaneProjector : public Projector4
+{
+  public:
+	Vector4 normal;
+	float distance = 0;
+
+	bool IsCullable(const SphereBounds4 &bound) const override
+	{
+		return Dot(normal, bound.center) - bound.radius > distance;
+	}
+
+	// Box entirely beyond the plane
+	bool IsCulled(const Bounds4 &box) const
+	{
+		const Vector4 e = box.extent();
+		return Dot(normal, box.center()) - (Abs(normal.x) * e.x + Abs(normal.y) * e.y + Abs(normal.z) * e.z + Abs(normal.w) * e.w) > distance;
+	}
+
+	void Project(const Buffer4 & /*from*/, const Transform4 & /*transform*/, Visualizer4 * /*to*/) override {}
+	Vector3 Project(const Vector4 &v) const override { return v.ToVec3(); }
+	Vector3 Project(const Vector4 &v, bool * /*culled*/) const override { return v.ToVec3(); }
+	SimplexMode SimplexModeForVisualizing(SimplexMode mode) const override { return mode; }
+};
+
+// Parent links, heights, balance and bounds of every node, returns the leaf count
+static int CheckNode(const SceneTree &tree, int id, int parent)
+{
+	const SceneTree::Node &n = tree.nodes[id];
+	CHECK_EQUAL(n.parent, parent);
+
+	if (n.IsLeaf())
+	{
+		CHECK_EQUAL(n.height, 0);
+		CHECK(n.data != NULL);
+		return 1;
+	}
+
+	const SceneTree::Node &l = tree.nodes[n.left], &r = tree.nodes[n.right];
+	CHECK_EQUAL(n.height, 1 + Max(l.height, r.height));
+	CHECK(Abs(l.height - r.height) <= 1);
+	CHECK(Within(n.aabb, l.aabb) && Within(n.aabb, r.aabb));
+
+	return CheckNode(tree, n.left, id) + CheckNode(tree, n.right, id);
+}
+
+int main(void)
+{
+	const int total = 400;
+	std::vector<Model4> models(total);
+	std::vector<Bounds4> boxes(total);
+	std::vector<int> proxies(total, -1);
+	SceneTree tree;
+	PlaneProjector projector;
+
+	for (int round = 0; round < 40; round++)
+	{
+		for (int i = 0; i < total; i++)
+		{
+			const float action = Random(0, 1);
+			if (proxies[i] < 0)
+			{
+				if (action < 0.7f)
+					proxies[i] = tree.Insert(boxes[i] = RandomBox(), &models[i]);
+			}
+			else if (action < 0.15f)
+			{
+				tree.Remove(proxies[i]);
+				proxies[i] = -1;
+			}
+			else if (action < 0.6f)
+			{
+				// Small moves stay within the fattened leaf, large ones don't
+				const float step = action < 0.4f ? 0.2f : 20.f;
+				const Vector4 d(Random(-step, step), Random(-step, step), Random(-step, step), Random(-step, step));
+				boxes[i] = Bounds4(boxes[i].min + d, boxes[i].max + d);
+				tree.Update(proxies[i], boxes[i]);
+			}
+		}
+
+		int live = 0;
+		for (int i = 0; i < total; i++)
+		{
+			if (proxies[i] < 0)
+				continue;
+			live++;
+
+			// Leaves keep their model and hold its current bounds
+			const SceneTree::Node &leaf = tree.nodes[proxies[i]];
+			CHECK(leaf.IsLeaf() && leaf.data == &models[i]);
+			CHECK(Within(leaf.aabb, boxes[i]));
+		}
+
+		CHECK_EQUAL(tree.count, live);
+		if (tree.root >= 0)
+			CHECK_EQUAL(CheckNode(tree, tree.root, -1), live);
+		else
+			CHECK_EQUAL(live, 0);
+
+		for (int q = 0; q < 10; q++)
+		{
+			projector.normal = Normalize(Vector4(Random(-1, 1), Random(-1, 1), Random(-1, 1), Random(-1, 1)));
+			projector.distance = Random(-60, 60);
+
+			std::vector<int> visited(total, 0);
+			tree.Query(projector, [&](Model4 *model) { visited[model - &models[0]]++; });
+
+			int missed = 0, extra = 0;
+			for (int i = 0; i < total; i++)
+			{
+				// Every model reaching the visible side is found, once
+				if (proxies[i] >= 0 && !projector.IsCulled(boxes[i]))
+					missed += visited[i] != 1;
+				// Anything else found is only there because of the sphere around its fattened leaf
+				else if (visited[i])
+				{
+					const Bounds4 &fat = tree.nodes[proxies[i]].aabb;
+					extra += proxies[i] < 0 || visited[i] != 1 || projector.IsCullable(SphereBounds4(fat.center(), Length(fat.extent())));
+				}
+			}
+			CHECK_EQUAL(missed, 0);
+			CHECK_EQUAL(extra, 0);
+		}
+	}
+
+	return CheckResult();
+}
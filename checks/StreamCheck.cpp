@@ -0,0 +1,147 @@
+// Ring, fence and orphan bookkeeping of StreamBuffer, through MemoryStreamTarget.
+
+#include "Check.h"
+
+using namespace Forth;
+
+// Point buffer of given vertex count (12 bytes each), filled with a recognizable pattern
+static void Fill(BufferGL &buffer, int vertices, float seed)
+{
+	buffer.Setup(SM_Point);
+	float *f = buffer.Push(vertices);
+	for (int i = 0; i < vertices * 3; i++)
+		f[i] = seed + i;
+}
+
+static bool Stored(const MemoryStreamTarget &target, int offset, const BufferGL &buffer)
+{
+	return memcmp(target.storage.data() + offset, buffer.vb, buffer.vb_count * sizeof(float)) == 0;
+}
+
+static void CheckPersistent(void)
+{
+	MemoryStreamTarget target(true);
+	StreamBuffer stream(target, 192, 3);
+	BufferGL a, b, empty, huge;
+	Fill(a, 2, 1);
+	Fill(b, 2, 100);
+	Fill(huge, 100, 1000);
+	empty.Setup(SM_Point);
+
+	// Storage is only allocated on the first frame
+	CHECK_EQUAL(target.allocations, 0);
+
+	stream.Begin();
+	CHECK_EQUAL(target.allocations, 1);
+	CHECK_EQUAL(stream.Capacity(), 192);
+	CHECK_EQUAL(stream.Push(a), 0);
+	// Offsets are 16 bytes aligned
+	CHECK_EQUAL(stream.Push(b), 32);
+	CHECK(Stored(target, 0, a) && Stored(target, 32, b));
+	stream.End();
+	CHECK_EQUAL(target.fences, 1);
+
+	// One segment per frame
+	for (int frame = 1; frame < 3; frame++)
+	{
+		stream.Begin();
+		CHECK_EQUAL(stream.Push(a), 64 * frame);
+		stream.End();
+	}
+	CHECK_EQUAL(target.fences, 3);
+	CHECK_EQUAL(target.waits, 0);
+
+	// Wrapped, the first segment is waited for before being overwritten
+	stream.Begin();
+	CHECK_EQUAL(target.waits, 1);
+	CHECK_EQUAL(stream.Push(b), 0);
+	CHECK_EQUAL(stream.Push(empty), 32);
+	CHECK(Stored(target, 0, b));
+	stream.End();
+
+	// Outgrown, the frame fails instead of moving storage under earlier offsets
+	stream.Begin();
+	CHECK_EQUAL(target.waits, 2);
+	const int generation = stream.Generation();
+	CHECK_EQUAL(stream.Push(a), 64);
+	CHECK_EQUAL(stream.Push(huge), -1);
+	CHECK_EQUAL(stream.Push(a), -1);
+	CHECK_EQUAL(stream.Generation(), generation);
+	CHECK_EQUAL(target.allocations, 1);
+	CHECK(Stored(target, 64, a));
+	stream.End();
+	CHECK_EQUAL(target.fences, 5);
+
+	// Then the next frame is grown to fit it
+	stream.Begin();
+	CHECK_EQUAL(stream.Generation(), generation + 1);
+	CHECK_EQUAL(target.allocations, 2);
+	CHECK(stream.Capacity() >= (32 + 1200 + 32) * 3);
+	CHECK_EQUAL(stream.Push(a), 0);
+	CHECK_EQUAL(stream.Push(huge), 32);
+	CHECK(Stored(target, 32, huge));
+	stream.End();
+	CHECK_EQUAL(target.fences, 6);
+	CHECK_EQUAL(target.uploads, 0);
+}
+
+static void CheckSized(void)
+{
+	MemoryStreamTarget target(true);
+	StreamBuffer stream(target, 192, 3);
+	BufferGL a, huge;
+	Fill(a, 2, 1);
+	Fill(huge, 100, 1000);
+	CHECK_EQUAL(StreamBuffer::Bytes(a), 32);
+	CHECK_EQUAL(StreamBuffer::Bytes(huge), 1200);
+
+	stream.Begin(StreamBuffer::Bytes(a));
+	CHECK_EQUAL(stream.Push(a), 0);
+	stream.End();
+
+	// Sized upfront, the ring grows before the first push so every offset holds
+	stream.Begin(StreamBuffer::Bytes(a) + StreamBuffer::Bytes(huge));
+	CHECK_EQUAL(target.allocations, 2);
+	const int start = stream.Push(a);
+	CHECK(start >= 0);
+	CHECK_EQUAL(stream.Push(huge), start + 32);
+	CHECK(Stored(target, start, a) && Stored(target, start + 32, huge));
+	stream.End();
+	CHECK_EQUAL(target.allocations, 2);
+}
+
+static void CheckOrphaned(void)
+{
+	MemoryStreamTarget target(false);
+	StreamBuffer stream(target, 192, 3);
+	BufferGL a, empty;
+	Fill(a, 2, 1);
+	empty.Setup(SM_Point);
+
+	for (int frame = 0; frame < 3; frame++)
+	{
+		stream.Begin();
+		CHECK_EQUAL(stream.Push(a), 64 * frame);
+		CHECK_EQUAL(stream.Push(empty), 64 * frame + 32);
+		CHECK(Stored(target, 64 * frame, a));
+		stream.End();
+	}
+
+	// Storage is orphaned once the ring wraps, nothing is fenced nor waited for
+	CHECK_EQUAL(target.allocations, 2);
+	CHECK_EQUAL(target.uploads, 3);
+	CHECK_EQUAL(target.fences, 0);
+	CHECK_EQUAL(target.waits, 0);
+
+	stream.Begin();
+	CHECK_EQUAL(stream.Push(a), 0);
+	stream.End();
+}
+
+int main(void)
+{
+	CheckPersistent();
+	CheckOrphaned();
+	CheckSized();
+	return CheckResult();
+}
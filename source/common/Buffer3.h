@@ -5,6 +5,7 @@
 #include "../math/Vector3.h"
 #include "Enums.h"
 #include "VertexProfile.h"
+#include <utility>
 #include <vector>
 
 namespace Forth
@@ -29,6 +30,15 @@ namespace Forth
 			indices_count = 0;
 		}
 
+		///
+		/// Make room for incoming vertices and indices upfront.
+		///
+		void Reserve(int incomingVertices, int incomingIndices)
+		{
+			EnsureCapacity(&vertices, vertices_count, &vertices_cap, vertices_count + incomingVertices);
+			EnsureCapacity(&indices, indices_count, &indices_cap, indices_count + incomingIndices);
+		}
+
 		void AddVert(const Vector3 &v)
 		{
 			EnsureCapacity(&vertices, vertices_count, &vertices_cap, vertices_count + 1);
@@ -55,5 +65,36 @@ namespace Forth
 			indices[indices_count++] = b;
 			indices[indices_count++] = c;
 		}
+
+		///
+		/// Append other buffer to the end, rebasing its indices.
+		///
+		void Append(const Buffer3 &other)
+		{
+			const int o = vertices_count;
+
+			EnsureCapacity(&vertices, vertices_count, &vertices_cap, vertices_count + other.vertices_count);
+			EnsureCapacity(&indices, indices_count, &indices_cap, indices_count + other.indices_count);
+
+			memcpy(vertices + vertices_count, other.vertices, other.vertices_count * sizeof(Vector3));
+			vertices_count += other.vertices_count;
+
+			for (int i = 0; i < other.indices_count; ++i)
+				indices[indices_count++] = other.indices[i] + o;
+		}
+
+		///
+		/// Exchange contents with other buffer without copying.
+		///
+		void Swap(Buffer3 &other)
+		{
+			std::swap(vertices, other.vertices);
+			std::swap(vertices_cap, other.vertices_cap);
+			std::swap(vertices_count, other.vertices_count);
+			std::swap(indices, other.indices);
+			std::swap(indices_cap, other.indices_cap);
+			std::swap(indices_count, other.indices_count);
+			std::swap(simplex, other.simplex);
+		}
 	};
 } // namespace Forth
\ No newline at end of file
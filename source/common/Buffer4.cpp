@@ -1,10 +1,15 @@
 
 #include "Buffer4.h"
+#include "../extras/HashMap.h"
+#include "../extras/Utils.h"
+#include <climits>
+#include <cstdint>
 
 namespace Forth
 {
 	void Buffer4::EnsureIndices(const int incoming)
 	{
+		Touch();
 		if (indiceCount + incoming > indiceCap)
 		{
 			Expand(&indices, indiceCount, indiceCap = Max(indiceCount + incoming, indiceCap << 1));
@@ -15,19 +20,410 @@ namespace Forth
 		if (verticeCount + incoming > verticeCap)
 		{
 			Expand(&vertices, verticeCount, verticeCap = Max(verticeCount + incoming, verticeCap << 1));
+			if (lanesBlock)
+				ExpandLanes(verticeCap);
+		}
+	}
+
+	void Buffer4::ExpandLanes(int newSize)
+	{
+		// Round up so every lane starts at 32 byte boundary
+		int cap = (newSize + 7) & ~7;
+		float *block = Allocate<float>(cap * 4 + 8);
+		float *base = (float *)(((uintptr_t)block + 31) & ~(uintptr_t)31);
+
+		for (int i = 0; i < 4; i++)
+		{
+			if (lanesBlock)
+				memcpy(base + cap * i, lanes[i], Min(verticeCount, cap) * sizeof(float));
+			lanes[i] = base + cap * i;
+		}
+
+		delete[] lanesBlock;
+		lanesBlock = block;
+		lanesCap = cap;
+	}
+
+	void Buffer4::SetLanes(bool enable)
+	{
+		if (enable && !lanesBlock)
+		{
+			ExpandLanes(verticeCap);
+			SyncLanes();
+		}
+		else if (!enable && lanesBlock)
+		{
+			delete[] lanesBlock;
+			lanesBlock = NULL;
+			lanes[0] = lanes[1] = lanes[2] = lanes[3] = NULL;
+			lanesCap = 0;
+		}
+	}
+
+	void Buffer4::SetTree(bool enable)
+	{
+		if (enable && !tree)
+		{
+			tree = new SimplexTree();
+			tree->Build(*this);
+		}
+		else if (!enable && tree)
+		{
+			delete tree;
+			tree = NULL;
+		}
+	}
+
+	void Buffer4::SetAdjacency(bool enable)
+	{
+		if (enable && !adjacency)
+		{
+			adjacency = new SimplexAdjacency();
+			adjacency->Build(*this);
+		}
+		else if (!enable && adjacency)
+		{
+			delete adjacency;
+			adjacency = NULL;
+		}
+	}
+
+	void Buffer4::SyncLanes(int start)
+	{
+		Touch();
+
+		if (!lanesBlock)
+			return;
+
+		for (int i = start; i < verticeCount; i++)
+		{
+			lanes[0][i] = vertices[i].x;
+			lanes[1][i] = vertices[i].y;
+			lanes[2][i] = vertices[i].z;
+			lanes[3][i] = vertices[i].w;
 		}
 	}
 
 	void Buffer4::Clear()
 	{
 		verticeCount = indiceCount = offset = 0;
+		Touch();
+
+		if (adjacency)
+			adjacency->Build(*this);
+	}
+
+	// Key of a spatial hash cell, never IntHashMap::Empty
+	static inline uint64_t CellKey(int x, int y, int z, int w)
+	{
+		uint64_t k = (uint64_t)(uint32_t)x * 0x9E3779B97F4A7C15ULL;
+		k = (k ^ (uint32_t)y) * 0xC2B2AE3D27D4EB4FULL;
+		k = (k ^ (uint32_t)z) * 0x165667B19E3779F9ULL;
+		k = (k ^ (uint32_t)w);
+		return k == IntHashMap::Empty ? 0 : k;
+	}
+
+	static inline int Cell(float f, float inv)
+	{
+		// Far away cells may share a key, which only costs extra comparisons
+		return (int)Clamp(-1e9f, 1e9f, Floor(f * inv));
+	}
+
+	static inline int FloatBits(float f)
+	{
+		// Both zeroes are the same vertex
+		if (f == 0)
+			f = 0;
+		int i;
+		memcpy(&i, &f, sizeof(i));
+		return i;
+	}
+
+	int Buffer4::Weld(float tolerance)
+	{
+		const int count = verticeCount;
+		if (count == 0)
+			return 0;
+
+		// Cells twice as large as tolerance, so anything in range is at most one cell away on each axis
+		const float size = tolerance * 2, inv = tolerance > 0 ? 1 / size : 0;
+		const float range = tolerance * tolerance;
+
+		IntHashMap cells;
+		cells.Reserve(count);
+		std::vector<int> next(count, -1), remap(count);
+		int kept = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			const Vector4 v = vertices[i];
+			int found = -1;
+
+			if (tolerance > 0)
+			{
+				int lo[4], hi[4];
+				for (int a = 0; a < 4; a++)
+				{
+					lo[a] = Cell(v[a] - tolerance, inv);
+					hi[a] = Cell(v[a] + tolerance, inv);
+				}
+
+				for (int x = lo[0]; x <= hi[0] && found < 0; x++)
+					for (int y = lo[1]; y <= hi[1] && found < 0; y++)
+						for (int z = lo[2]; z <= hi[2] && found < 0; z++)
+							for (int w = lo[3]; w <= hi[3] && found < 0; w++)
+								for (int j = cells.Find(CellKey(x, y, z, w)); j >= 0 && found < 0; j = next[j])
+								{
+									if (DistanceSq(vertices[j], v) <= range)
+										found = j;
+								}
+			}
+			else
+			{
+				for (int j = cells.Find(CellKey(FloatBits(v.x), FloatBits(v.y), FloatBits(v.z), FloatBits(v.w))); j >= 0; j = next[j])
+				{
+					if (vertices[j].x == v.x && vertices[j].y == v.y && vertices[j].z == v.z && vertices[j].w == v.w)
+					{
+						found = j;
+						break;
+					}
+				}
+			}
+
+			if (found >= 0)
+			{
+				remap[i] = remap[found];
+				continue;
+			}
+
+			// Keep it, heading the list of its own cell
+			const uint64_t key = tolerance > 0
+									 ? CellKey(Cell(v.x, inv), Cell(v.y, inv), Cell(v.z, inv), Cell(v.w, inv))
+									 : CellKey(FloatBits(v.x), FloatBits(v.y), FloatBits(v.z), FloatBits(v.w));
+			bool added;
+			int &head = cells.Get(key, -1, &added);
+			next[i] = head;
+			head = i;
+			remap[i] = kept++;
+		}
+
+		// Kept vertices only move backward, so compaction can be done in place
+		int last = -1;
+		for (int i = 0; i < count; i++)
+		{
+			if (remap[i] > last)
+			{
+				vertices[remap[i]] = vertices[i];
+				last = remap[i];
+			}
+		}
+
+		// Remap indices, dropping simplices with a repeated vertex
+		const int stride = simplex + 1;
+		int n = 0;
+		for (int i = 0; i + stride <= indiceCount; i += stride)
+		{
+			int t[4];
+			bool degenerate = false;
+			for (int a = 0; a < stride; a++)
+			{
+				t[a] = remap[indices[i + a]];
+				for (int b = 0; b < a; b++)
+					degenerate |= t[a] == t[b];
+			}
+
+			if (degenerate)
+				continue;
+
+			for (int a = 0; a < stride; a++)
+				indices[n++] = t[a];
+		}
+
+		indiceCount = n;
+		verticeCount = kept;
+		offset = 0;
+
+		if (lanesBlock)
+			SyncLanes();
+		Touch();
+
+		if (adjacency)
+			adjacency->Build(*this);
+
+		return count - kept;
+	}
+
+	// Vertex misses of given indices through a FIFO cache
+	static int CacheMisses(const int *indices, int count, int vertices, int cacheSize)
+	{
+		// A vertex stays in the cache until cacheSize other misses happened
+		std::vector<int> stamp(vertices, INT_MIN / 2);
+		int misses = 0;
+		for (int i = 0; i < count; i++)
+		{
+			const int v = indices[i];
+			if (misses - stamp[v] >= cacheSize)
+				stamp[v] = misses++;
+		}
+		return misses;
+	}
+
+	float Buffer4::CacheMissRatio(int cacheSize) const
+	{
+		const int stride = simplex + 1, count = indiceCount / stride;
+		if (count == 0)
+			return 0;
+
+		return (float)CacheMisses(indices, count * stride, verticeCount, cacheSize) / count;
+	}
+
+	float Buffer4::Optimize(int cacheSize)
+	{
+		const int stride = simplex + 1, count = indiceCount / stride;
+		if (count == 0)
+			return 0;
+
+		// Simplices around each vertex
+		std::vector<int> live(verticeCount, 0), start(verticeCount + 1, 0), around(count * stride);
+		for (int i = 0; i < count * stride; i++)
+			live[indices[i]]++;
+		for (int v = 0; v < verticeCount; v++)
+			start[v + 1] = start[v] + live[v];
+		{
+			std::vector<int> fill(start.begin(), start.end() - 1);
+			for (int i = 0; i < count * stride; i++)
+				around[fill[indices[i]]++] = i / stride;
+		}
+
+		std::vector<int> stamp(verticeCount, INT_MIN / 2), stack, candidates;
+		std::vector<bool> emitted(count, false);
+		std::vector<int> result;
+		result.reserve(count * stride);
+
+		int time = 0, cursor = 0, fanning = indices[0];
+		stack.reserve(count * stride);
+
+		while (fanning >= 0)
+		{
+			// Emit every simplex around the fanning vertex
+			candidates.clear();
+			for (int k = start[fanning]; k < start[fanning + 1]; k++)
+			{
+				const int t = around[k];
+				if (emitted[t])
+					continue;
+				emitted[t] = true;
+
+				for (int a = 0; a < stride; a++)
+				{
+					const int v = indices[t * stride + a];
+					result.push_back(v);
+					stack.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					if (time - stamp[v] >= cacheSize)
+						stamp[v] = time++;
+				}
+			}
+
+			// Next, the candidate with most to gain that stays in cache while fanning it
+			int best = -1, priority = -1;
+			for (int v : candidates)
+			{
+				if (live[v] <= 0)
+					continue;
+				int p = 0;
+				if (time - stamp[v] + simplex * live[v] <= cacheSize)
+					p = time - stamp[v];
+				if (p > priority)
+				{
+					priority = p;
+					best = v;
+				}
+			}
+
+			// Dead end, fall back on recently used vertices, then on the next one in order
+			while (best < 0 && !stack.empty())
+			{
+				const int v = stack.back();
+				stack.pop_back();
+				if (live[v] > 0)
+					best = v;
+			}
+
+			while (best < 0 && cursor < verticeCount)
+			{
+				if (live[cursor] > 0)
+					best = cursor;
+				cursor++;
+			}
+
+			fanning = best;
+		}
+
+		// The greedy pass may lose to an order already tuned for another cache size, keep the better one
+		if (CacheMisses(result.data(), count * stride, verticeCount, cacheSize) > CacheMisses(indices, count * stride, verticeCount, cacheSize))
+			result.assign(indices, indices + count * stride);
+
+		// Renumber vertices by first use, unused ones go last in their former order
+		std::vector<int> remap(verticeCount, -1);
+		int n = 0;
+		for (int v : result)
+			if (remap[v] < 0)
+				remap[v] = n++;
+		for (int v = 0; v < verticeCount; v++)
+			if (remap[v] < 0)
+				remap[v] = n++;
+
+		std::vector<Vector4> moved(vertices, vertices + verticeCount);
+		for (int v = 0; v < verticeCount; v++)
+			vertices[remap[v]] = moved[v];
+
+		for (int i = 0; i < indiceCount; i++)
+			indices[i] = remap[i < count * stride ? result[i] : indices[i]];
+
+		offset = 0;
+
+		if (lanesBlock)
+			SyncLanes();
+		Touch();
+
+		// Simplex order changed, refitting isn't enough
+		if (tree)
+			tree->Build(*this);
+		if (adjacency)
+			adjacency->Build(*this);
+
+		return CacheMissRatio(cacheSize);
+	}
+
+	SphereBounds4 Buffer4::GetBounds() const
+	{
+		if (verticeCount == 0)
+			return SphereBounds4();
+
+		// Center of the box, then the farthest vertex from it
+		Bounds4 box(vertices[0], vertices[0]);
+		for (int i = 1; i < verticeCount; i++)
+			box.Allocate(vertices[i]);
+
+		const Vector4 center = box.center();
+		float radius = 0;
+		for (int i = 0; i < verticeCount; i++)
+			radius = Max(radius, DistanceSq(center, vertices[i]));
+
+		return SphereBounds4(center, Sqrt(radius));
 	}
 
 	void Buffer4::Clean()
 	{
 		Clear();
-		indices = new int[indiceCap = 4];
-		vertices = new Vector4[verticeCap = 4];
+		delete[] indices;
+		delete[] vertices;
+		indices = Allocate<int>(indiceCap = 4);
+		vertices = Allocate<Vector4>(verticeCap = 4);
+		if (lanesBlock)
+			ExpandLanes(verticeCap);
 	}
 
 	Buffer4::Buffer4()
@@ -36,6 +432,15 @@ namespace Forth
 		simplex = SM_Tetrahedron;
 	}
 
+	Buffer4::~Buffer4()
+	{
+		delete[] indices;
+		delete[] vertices;
+		delete[] lanesBlock;
+		delete tree;
+		delete adjacency;
+	}
+
 	void Buffer4::Align() { offset = verticeCount; }
 
 	void Buffer4::Align(int snapshot) { offset = snapshot; }
@@ -70,7 +475,7 @@ namespace Forth
 
 	void Buffer4::AddSimplex(int i, int j, int k, int l)
 	{
-		EnsureIndices(2);
+		EnsureIndices(4);
 		indices[indiceCount++] = (i + offset);
 		indices[indiceCount++] = (j + offset);
 		indices[indiceCount++] = (k + offset);
@@ -275,14 +680,14 @@ namespace Forth
 	int Buffer4::AddVertex(int idx)
 	{
 		EnsureVertices(1);
-		vertices[verticeCount] = (vertices[idx + offset]);
+		SetVertex(verticeCount, vertices[idx + offset]);
 		return verticeCount++ - offset;
 	}
 
 	int Buffer4::AddVertex(Vector4 vert)
 	{
 		EnsureVertices(1);
-		vertices[verticeCount] = vert;
+		SetVertex(verticeCount, vert);
 		return verticeCount++ - offset;
 	}
 
@@ -393,7 +798,7 @@ namespace Forth
 	template <typename T>
 	void Buffer4::Expand(T **arr, int count, int newSize)
 	{
-		T *newArr = new T[newSize];
+		T *newArr = Allocate<T>(newSize);
 
 		memcpy(newArr, *arr, count * sizeof(T));
 
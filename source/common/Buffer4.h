@@ -1,7 +1,10 @@
 #pragma once
 
+#include "../math/SphereBounds4.h"
 #include "../math/Vector4.h"
 #include "Enums.h"
+#include "SimplexAdjacency.h"
+#include "SimplexTree.h"
 #include "VertexProfile.h"
 #include <cstdarg>
 #include <cstring>
@@ -15,8 +18,8 @@ namespace Forth
 	struct Buffer4
 	{
 
-		Vector4 *vertices;
-		int *indices;
+		Vector4 *vertices = NULL;
+		int *indices = NULL;
 
 		int verticeCount, indiceCount;
 		int verticeCap, indiceCap;
@@ -24,15 +27,128 @@ namespace Forth
 
 		SimplexMode simplex;
 
+		/// <summary>
+		/// Bumped whenever vertices or indices change through this struct's methods.
+		/// </summary>
+		/// <remarks>
+		/// Call Touch() (or SyncLanes()) after writing to the arrays directly.
+		/// </remarks>
+		unsigned long version = 0;
+
+		/// <summary>
+		/// Optional structure-of-arrays mirror of vertices, one 32-byte aligned array per axis.
+		/// </summary>
+		/// <remarks>
+		/// Enabled via SetLanes(). Kept in sync by AddVertex() and SetVertex(),
+		/// call SyncLanes() after writing to vertices directly.
+		/// </remarks>
+		float *lanes[4] = {NULL, NULL, NULL, NULL};
+		float *lanesBlock = NULL;
+		int lanesCap = 0;
+
+		/// <summary>
+		/// Optional hierarchy over simplices, letting projectors skip whole groups of them.
+		/// </summary>
+		/// <remarks>
+		/// Enabled via SetTree(). Projectors rebuild or refit it when the buffer's version changes.
+		/// </remarks>
+		SimplexTree *tree = NULL;
+
+		/// <summary>
+		/// Optional table of neighbouring simplices, letting slices march from a crossing simplex to the next.
+		/// </summary>
+		/// <remarks>
+		/// Enabled via SetAdjacency(). Marched by CrossSection when given seeds, which extends it for appended simplices.
+		/// Otherwise call adjacency->Update() after appending simplices, methods of this struct rewriting indices rebuild it themselves.
+		/// </remarks>
+		SimplexAdjacency *adjacency = NULL;
+
 		template <typename T>
 		void Expand(T **arr, int count, int newSize);
 
+		void ExpandLanes(int newSize);
+
 		void EnsureIndices(const int incoming);
 
 		void EnsureVertices(const int incoming);
 
 		bool IsEmpty(void) { return verticeCount == 0; }
 
+		bool HasLanes(void) const { return lanesBlock != NULL; }
+
+		/// <summary>
+		/// Enable or disable the structure-of-arrays mirror of vertices.
+		/// </summary>
+		void SetLanes(bool enable);
+
+		/// <summary>
+		/// Enable (and build) or disable the simplex hierarchy.
+		/// </summary>
+		void SetTree(bool enable);
+
+		/// <summary>
+		/// Enable (and build) or disable the neighbour table.
+		/// </summary>
+		void SetAdjacency(bool enable);
+
+		/// <summary>
+		/// Refresh lanes from vertices starting at given index.
+		/// </summary>
+		void SyncLanes(int start = 0);
+
+		/// <summary>
+		/// Mark the buffer as changed.
+		/// </summary>
+		void Touch(void) { ++version; }
+
+		/// <summary>
+		/// Bounding sphere of all vertices.
+		/// </summary>
+		SphereBounds4 GetBounds(void) const;
+
+		/// <summary> Overwrite a vertex (absolute index), keeping lanes in sync </summary>
+		void SetVertex(int idx, const Vector4 &vert)
+		{
+			++version;
+			vertices[idx] = vert;
+			if (lanesBlock)
+			{
+				lanes[0][idx] = vert.x;
+				lanes[1][idx] = vert.y;
+				lanes[2][idx] = vert.z;
+				lanes[3][idx] = vert.w;
+			}
+		}
+
+		/// <summary>
+		/// Merge vertices closer than tolerance (exactly equal if zero), remap indices
+		/// and drop simplices left with repeated vertices. Returns the amount of vertices removed.
+		/// </summary>
+		/// <remarks>
+		/// Runs in linear time through a 4D spatial hash. Each vertex is merged into the first
+		/// kept one in range, so chains longer than tolerance aren't collapsed.
+		/// Vertex order is kept and offset is reset, so Align() again before sequencing.
+		/// </remarks>
+		int Weld(float tolerance = 0);
+
+		/// <summary>
+		/// Average vertex misses per simplex through a FIFO cache of given size (lower is better).
+		/// </summary>
+		/// <remarks>
+		/// Ranges from about 1/simplex (each vertex loaded once) to simplex + 1 (nothing reused).
+		/// </remarks>
+		float CacheMissRatio(int cacheSize = 32) const;
+
+		/// <summary>
+		/// Reorder simplices so neighbouring ones share vertices, then renumber vertices by first use.
+		/// Never raises CacheMissRatio(), which is returned.
+		/// </summary>
+		/// <remarks>
+		/// Tipsify-like greedy pass, linear in the amount of indices.
+		/// Winding inside each simplex is kept. Offset is reset, so Align() again before sequencing.
+		/// </remarks>
+		float Optimize(int cacheSize = 32);
+
 		void Clear(void);
 
 		///
@@ -42,6 +158,12 @@ namespace Forth
 
 		Buffer4();
 
+		~Buffer4(void);
+
+		// Owns its arrays (and the optional structures below), so it can't be shallow copied
+		Buffer4(const Buffer4 &) = delete;
+		Buffer4 &operator=(const Buffer4 &) = delete;
+
 		/// <summary>
 		/// Move buffer forward to the end.
 		/// </summary>
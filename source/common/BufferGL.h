@@ -5,15 +5,19 @@
 #include "../math/Vector3.h"
 #include "Buffer3.h"
 #include "Enums.h"
+#include <utility>
 #include <vector>
 
 namespace Forth
 {
 	struct BufferGL
 	{
-		// Layout: 0-2 Position. 3-5 Normal
+		// Layout: 0-2 Position. 3-5 Normal. Raw bytes described by attr once quantized by Pack()
 		FORTH_ARRAY(vb, float);
 
+		// Indices to vb when indexed, 16-bit packed after PackIndices() if they fit
+		FORTH_ARRAY(ib, unsigned int);
+
 		struct
 		{
 			int counts[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
@@ -21,11 +25,37 @@ namespace Forth
 			int stripe = 0;
 			int simplex = 0;
 			int vertexs = 0;
+			int indexs = 0;
+			int indexSize = 0; // Bytes per index, 0 if not indexed
+
+			// Uploaded layout, per slot
+			AttributeFormat formats[10] = {};
+			int offsets[10] = {}; // Bytes from start of the vertex
+			int stride = 0;		  // Bytes per vertex
+
+			// AF_Short positions are dequantized as origin + extent * value
+			Vector3 origin = Vector3();
+			Vector3 extent = Vector3(1);
 		} attr;
 
 		struct
 		{
 			bool normal = true;
+
+			/// Keep vertices shared and draw through indices (glDrawElements).
+			/// Flat normals then only hold on the last (provoking) vertex of each triangle,
+			/// so the shader must declare them flat.
+			bool indexed = false;
+
+			/// Average normals of shared vertices, weighted by area, instead of flat ones.
+			/// Output is then indexed. Vertices are only shared with CrossSection::weld.
+			bool smooth = false;
+
+			/// Format of positions uploaded, either AF_Float or AF_Short
+			AttributeFormat positionFormat = AF_Float;
+
+			/// Format of normals uploaded, either AF_Float, AF_Octahedral or AF_Packed
+			AttributeFormat normalFormat = AF_Float;
 		} generate;
 
 		BufferGL(void) {}
@@ -33,27 +63,209 @@ namespace Forth
 		~BufferGL(void)
 		{
 			delete[] vb;
+			delete[] ib;
 		}
 
 		void Clear(void)
 		{
 			vb_count = 0;
+			ib_count = 0;
+			attr.vertexs = 0;
+			attr.indexs = 0;
+		}
+
+		/// <summary>
+		/// Make room for incoming vertices.
+		/// </summary>
+		void Reserve(int vertices)
+		{
+			EnsureCapacity(&vb, vb_count, &vb_cap, vb_count + vertices * attr.stripe);
+		}
+
+		/// <summary>
+		/// Grow by given vertex count, return where the first one should be written.
+		/// </summary>
+		float *Push(int vertices)
+		{
+			Reserve(vertices);
+			float *f = vb + vb_count;
+			vb_count += vertices * attr.stripe;
+			attr.vertexs += vertices;
+			return f;
+		}
+
+		/// <summary>
+		/// Make room for incoming indices.
+		/// </summary>
+		void ReserveIndices(int indices)
+		{
+			EnsureCapacity(&ib, ib_count, &ib_cap, ib_count + indices);
+		}
+
+		/// <summary>
+		/// Append an index (unpacked buffer only).
+		/// </summary>
+		void AddIndex(int i)
+		{
+			EnsureCapacity(&ib, ib_count, &ib_cap, ib_count + 1);
+			ib[ib_count++] = (unsigned int)i;
+			attr.indexs++;
+		}
+
+		/// <summary>
+		/// Append a vertex, with normal left unassigned (zero). Return its index.
+		/// </summary>
+		int AddVertex(const Vector3 &v)
+		{
+			float *f = Push(1);
+			f[0] = v.x;
+			f[1] = v.y;
+			f[2] = v.z;
+			if (HasNormals())
+				f[3] = f[4] = f[5] = 0;
+			return attr.vertexs - 1;
+		}
+
+		/// <summary>
+		/// Append a convex polygon of vertices added before, as a triangle fan.
+		/// Normal is weighted by the polygon area, or normalized if flat shaded.
+		/// </summary>
+		/// <remarks>
+		/// When smooth, the normal is summed into every vertex and normalized by Pack().
+		/// Otherwise, the fan is rotated around a vertex whose normal isn't assigned yet,
+		/// which becomes the last (provoking) vertex of every triangle.
+		/// If all of them are taken, the first one is duplicated.
+		/// </remarks>
+		void AddPolygon(const int *indices, int count, const Vector3 &normal)
+		{
+			if (generate.smooth)
+			{
+				AddSmoothPolygon(indices, count, normal);
+				return;
+			}
+
+			int k = 0;
+			while (k < count && !IsUnassigned(indices[k]))
+				k++;
+
+			int center;
+			if (k < count)
+				center = indices[k];
+			else
+			{
+				k = 0;
+				const float *f = vb + indices[0] * attr.stripe;
+				center = AddVertex(Vector3(f[0], f[1], f[2]));
+			}
+
+			const Vector3 unit = Forth::Normalize(normal);
+			float *n = vb + center * attr.stripe + 3;
+			n[0] = unit.x;
+			n[1] = unit.y;
+			n[2] = unit.z;
+
+			ReserveIndices(3 * (count - 2));
+			for (int i = 1; i < count - 1; i++)
+			{
+				ib[ib_count++] = indices[(k + i) % count];
+				ib[ib_count++] = indices[(k + i + 1) % count];
+				ib[ib_count++] = center;
+			}
+			attr.indexs += 3 * (count - 2);
+		}
+
+		/// <summary>
+		/// Narrow indices and quantize vertices as set in generate, once the buffer is complete.
+		/// Call Setup() before appending again.
+		/// </summary>
+		void Pack(void)
+		{
+			if (generate.smooth && HasNormals())
+				NormalizeNormals();
+			PackIndices();
+			PackVertices();
+		}
+
+		/// <summary>
+		/// Narrow indices to 16 bits if vertices fit.
+		/// </summary>
+		void PackIndices(void)
+		{
+			if (attr.indexSize != 4 || attr.vertexs > 0x10000)
+				return;
+
+			// Never overwrites an index not read yet
+			char *dst = (char *)ib;
+			for (int i = 0; i < ib_count; i++)
+			{
+				const unsigned short s = (unsigned short)ib[i];
+				memcpy(dst + i * sizeof(s), &s, sizeof(s));
+			}
+			attr.indexSize = 2;
+		}
+
+		bool HasNormals(void) const
+		{
+			return attr.slots > 1;
+		}
+
+		bool IsIndexed(void) const
+		{
+			return attr.indexSize > 0;
+		}
+
+		/// <summary>
+		/// Size of index data in bytes.
+		/// </summary>
+		int IndexBytes(void) const
+		{
+			return attr.indexs * attr.indexSize;
+		}
+
+		/// <summary>
+		/// Empty the buffer and lay out attributes for given simplex.
+		/// </summary>
+		void Setup(SimplexMode simplex)
+		{
+			Clear();
+
+			attr.simplex = simplex + 1;
+			attr.stripe = 3;
+			attr.slots = 1;
+			attr.counts[0] = 3; // First: Vertice Positions
+			attr.indexSize = generate.indexed || generate.smooth ? 4 : 0;
+
+			if (simplex == SM_Triangle && generate.normal)
+			{
+				attr.counts[1] = 3; // Second: Normal
+				attr.slots++;
+				attr.stripe += 3;
+			}
+
+			for (int i = 0; i < attr.slots; i++)
+			{
+				attr.formats[i] = AF_Float;
+				attr.offsets[i] = i * 3 * sizeof(float);
+			}
+			attr.stride = attr.stripe * sizeof(float);
+			attr.origin = Vector3();
+			attr.extent = Vector3(1);
 		}
 
-		void FillVertices(const Buffer3 &v, int offset)
+		void FillVertices(const Buffer3 &v, int offset, int start = 0)
 		{
-			for (int i = 0; i < attr.vertexs; ++i)
+			for (int i = 0; i < v.indices_count; ++i)
 			{
 				auto &f = v.vertices[v.indices[i]];
-				vb[i * attr.stripe + offset + 0] = f.x;
-				vb[i * attr.stripe + offset + 1] = f.y;
-				vb[i * attr.stripe + offset + 2] = f.z;
+				vb[(start + i) * attr.stripe + offset + 0] = f.x;
+				vb[(start + i) * attr.stripe + offset + 1] = f.y;
+				vb[(start + i) * attr.stripe + offset + 2] = f.z;
 			}
 		}
 
-		void FillNormals(const Buffer3 &v, int offset)
+		void FillNormals(const Buffer3 &v, int offset, int start = 0)
 		{
-			for (int i = 0; i < attr.vertexs;i += 3)
+			for (int i = 0; i < v.indices_count; i += 3)
 			{
 				const int a = v.indices[i + 0],
 						  b = v.indices[i + 1],
@@ -64,38 +276,293 @@ namespace Forth
 							  &cv = v.vertices[c],
 							  nv = Forth::Normalize(Forth::Cross(bv - cv, av - cv));
 
-				for (int j = 0; j < 3;++j)
+				for (int j = 0; j < 3; ++j)
 				{
-					vb[(i + j) * attr.stripe + offset + 0] = nv.x;
-					vb[(i + j) * attr.stripe + offset + 1] = nv.y;
-					vb[(i + j) * attr.stripe + offset + 2] = nv.z;
+					vb[(start + i + j) * attr.stripe + offset + 0] = nv.x;
+					vb[(start + i + j) * attr.stripe + offset + 1] = nv.y;
+					vb[(start + i + j) * attr.stripe + offset + 2] = nv.z;
 				}
 			}
 		}
 
+		/// <summary>
+		/// Append given buffer, which must match the current layout.
+		/// It's de-indexed unless this buffer is indexed.
+		/// </summary>
+		void Append(const Buffer3 &v)
+		{
+			if (IsIndexed())
+			{
+				AppendIndexed(v);
+				return;
+			}
+
+			const int start = attr.vertexs;
+			Push(v.indices_count);
+
+			FillVertices(v, 0, start);
+			if (HasNormals())
+				FillNormals(v, 3, start);
+		}
+
 		void Copy(const Buffer3 &v)
+		{
+			Setup(v.simplex);
+			Append(v);
+			Pack();
+		}
+
+		/// <summary>
+		/// Can vertices of both buffers go in a single draw call?
+		/// </summary>
+		bool SameLayout(const BufferGL &other) const
+		{
+			if (attr.simplex != other.attr.simplex || attr.slots != other.attr.slots ||
+				attr.stride != other.attr.stride || IsIndexed() != other.IsIndexed())
+				return false;
+
+			for (int i = 0; i < attr.slots; i++)
+				if (attr.counts[i] != other.attr.counts[i] || attr.formats[i] != other.attr.formats[i] ||
+					attr.offsets[i] != other.attr.offsets[i])
+					return false;
+
+			// Quantized positions are relative to their own bounds
+			return attr.formats[0] != AF_Short ||
+				   (memcmp(&attr.origin, &other.attr.origin, sizeof(Vector3)) == 0 &&
+					memcmp(&attr.extent, &other.attr.extent, sizeof(Vector3)) == 0);
+		}
+
+		/// <summary>
+		/// Empty the buffer and take the (packed) layout of other buffer, for Merge().
+		/// </summary>
+		void SetupLike(const BufferGL &other)
 		{
 			Clear();
+			attr = other.attr;
+			attr.vertexs = 0;
+			attr.indexs = 0;
+			attr.indexSize = other.IsIndexed() ? 4 : 0;
+		}
 
-			attr.vertexs = v.indices_count;
-			attr.simplex = v.simplex + 1;
-			attr.stripe = 3;
-			attr.slots = 1;
-			attr.counts[0] = 3; // First: Vertice Positions
+		/// <summary>
+		/// Append a complete (packed) buffer of the same layout, rebasing its indices.
+		/// </summary>
+		void Merge(const BufferGL &other)
+		{
+			const int base = attr.vertexs;
 
-			bool genNormal = v.simplex == SM_Triangle && generate.normal;
-			if (genNormal)
+			EnsureCapacity(&vb, vb_count, &vb_cap, vb_count + other.vb_count);
+			memcpy(vb + vb_count, other.vb, other.vb_count * sizeof(float));
+			vb_count += other.vb_count;
+			attr.vertexs += other.attr.vertexs;
+
+			if (!IsIndexed())
+				return;
+
+			ReserveIndices(other.attr.indexs);
+			if (other.attr.indexSize == 2)
 			{
-				attr.counts[1] = 3; // Second: Normal
-				attr.slots++;
-				attr.stripe += 3;
+				const char *src = (const char *)other.ib;
+				for (int i = 0; i < other.attr.indexs; i++)
+				{
+					unsigned short s;
+					memcpy(&s, src + i * sizeof(s), sizeof(s));
+					ib[ib_count++] = base + s;
+				}
+			}
+			else
+			{
+				for (int i = 0; i < other.attr.indexs; i++)
+					ib[ib_count++] = base + other.ib[i];
+			}
+			attr.indexs += other.attr.indexs;
+		}
+
+		/// <summary>
+		/// Exchange contents with other buffer without copying.
+		/// </summary>
+		void Swap(BufferGL &other)
+		{
+			std::swap(vb, other.vb);
+			std::swap(vb_cap, other.vb_cap);
+			std::swap(vb_count, other.vb_count);
+			std::swap(ib, other.ib);
+			std::swap(ib_cap, other.ib_cap);
+			std::swap(ib_count, other.ib_count);
+			std::swap(attr, other.attr);
+			std::swap(generate, other.generate);
+		}
+
+	  private:
+		static inline short ToShort(float v)
+		{
+			return (short)std::lround(Clamp(-1.f, 1.f, v) * 32767.f);
+		}
+
+		static inline unsigned int ToTen(float v)
+		{
+			return (unsigned int)std::lround(Clamp(-1.f, 1.f, v) * 511.f) & 0x3FF;
+		}
+
+		/// <summary>
+		/// Rewrite float vertices in place into formats set in generate.
+		/// Packed vertices are never larger, so nothing is overwritten before being read.
+		/// </summary>
+		void PackVertices(void)
+		{
+			const bool normals = HasNormals();
+			const AttributeFormat pf = generate.positionFormat,
+								  nf = normals ? generate.normalFormat : AF_Float;
+
+			if (pf == AF_Float && nf == AF_Float)
+				return;
+
+			if (pf == AF_Short)
+			{
+				Vector3 lo = Vector3(MAX_FLOAT), hi = Vector3(-MAX_FLOAT);
+				for (int i = 0; i < attr.vertexs; i++)
+				{
+					const float *f = vb + i * attr.stripe;
+					lo = Vector3(Min(lo.x, f[0]), Min(lo.y, f[1]), Min(lo.z, f[2]));
+					hi = Vector3(Max(hi.x, f[0]), Max(hi.y, f[1]), Max(hi.z, f[2]));
+				}
+				if (attr.vertexs > 0)
+				{
+					attr.origin = (lo + hi) * 0.5f;
+					attr.extent = (hi - lo) * 0.5f;
+				}
+				// Flat extents would divide by zero
+				attr.extent = Vector3(attr.extent.x > 0 ? attr.extent.x : 1,
+									  attr.extent.y > 0 ? attr.extent.y : 1,
+									  attr.extent.z > 0 ? attr.extent.z : 1);
+			}
+
+			// Shorts are padded to 8 bytes, keeping the next attribute 4 bytes aligned
+			const int psize = pf == AF_Short ? 4 * sizeof(short) : 3 * sizeof(float);
+			const int nsize = !normals ? 0 : nf == AF_Float ? 3 * sizeof(float) : 4;
+			const int stride = psize + nsize;
+
+			char *dst = (char *)vb;
+			for (int i = 0; i < attr.vertexs; i++)
+			{
+				const float *f = vb + i * attr.stripe;
+				const Vector3 p = Vector3(f[0], f[1], f[2]);
+				const Vector3 n = normals ? Vector3(f[3], f[4], f[5]) : Vector3();
+				char *d = dst + i * stride;
+
+				if (pf == AF_Short)
+				{
+					const Vector3 q = p - attr.origin;
+					const short s[4] = {ToShort(q.x / attr.extent.x), ToShort(q.y / attr.extent.y), ToShort(q.z / attr.extent.z), 0};
+					memcpy(d, s, sizeof(s));
+				}
+				else
+					memcpy(d, &p.x, psize);
+
+				d += psize;
+
+				if (nf == AF_Octahedral)
+				{
+					// Project onto the octahedron, folding the lower half over
+					const float l = Abs(n.x) + Abs(n.y) + Abs(n.z);
+					float x = l > 0 ? n.x / l : 0, y = l > 0 ? n.y / l : 0;
+					if (n.z < 0)
+					{
+						const float fx = (1 - Abs(y)) * (x < 0 ? -1 : 1);
+						y = (1 - Abs(x)) * (y < 0 ? -1 : 1);
+						x = fx;
+					}
+					const short s[2] = {ToShort(x), ToShort(y)};
+					memcpy(d, s, sizeof(s));
+				}
+				else if (nf == AF_Packed)
+				{
+					const unsigned int u = ToTen(n.x) | (ToTen(n.y) << 10) | (ToTen(n.z) << 20);
+					memcpy(d, &u, sizeof(u));
+				}
+				else if (normals)
+					memcpy(d, &n.x, nsize);
+			}
+
+			attr.formats[0] = pf;
+			attr.offsets[0] = 0;
+			if (normals)
+			{
+				attr.formats[1] = nf;
+				attr.offsets[1] = psize;
+				attr.counts[1] = nf == AF_Octahedral ? 2 : nf == AF_Packed ? 4 : 3;
+			}
+			attr.stride = stride;
+			vb_count = attr.vertexs * stride / sizeof(float);
+		}
+
+		void AddSmoothPolygon(const int *indices, int count, const Vector3 &normal)
+		{
+			ReserveIndices(3 * (count - 2));
+			for (int i = 2; i < count; i++)
+			{
+				ib[ib_count++] = indices[0];
+				ib[ib_count++] = indices[i - 1];
+				ib[ib_count++] = indices[i];
 			}
+			attr.indexs += 3 * (count - 2);
 
-			EnsureCapacity(&vb, 0, &vb_cap, vb_count = attr.vertexs * attr.stripe);
+			for (int i = 0; i < count; i++)
+			{
+				float *n = vb + indices[i] * attr.stripe + 3;
+				n[0] += normal.x;
+				n[1] += normal.y;
+				n[2] += normal.z;
+			}
+		}
+
+		void NormalizeNormals(void)
+		{
+			for (int i = 0; i < attr.vertexs; i++)
+			{
+				float *n = vb + i * attr.stripe + 3;
+				const Vector3 v = Forth::Normalize(Vector3(n[0], n[1], n[2]));
+				n[0] = v.x;
+				n[1] = v.y;
+				n[2] = v.z;
+			}
+		}
+
+		bool IsUnassigned(int vertex) const
+		{
+			const float *n = vb + vertex * attr.stripe + 3;
+			return n[0] == 0 && n[1] == 0 && n[2] == 0;
+		}
+
+		void AppendIndexed(const Buffer3 &v)
+		{
+			const int start = attr.vertexs;
+			Reserve(v.vertices_count);
+			for (int i = 0; i < v.vertices_count; ++i)
+				AddVertex(v.vertices[i]);
+
+			if (!HasNormals())
+			{
+				ReserveIndices(v.indices_count);
+				for (int i = 0; i < v.indices_count; ++i)
+					ib[ib_count++] = start + v.indices[i];
+				attr.indexs += v.indices_count;
+				return;
+			}
+
+			for (int i = 0; i < v.indices_count; i += 3)
+			{
+				const int t[3] = {start + v.indices[i + 0],
+								  start + v.indices[i + 1],
+								  start + v.indices[i + 2]};
 
-			FillVertices(v, 0);
-			if (genNormal)
-				FillNormals(v, 3);
+				// Same orientation as FillNormals()
+				const Vector3 &av = v.vertices[v.indices[i + 0]],
+							  &bv = v.vertices[v.indices[i + 1]],
+							  &cv = v.vertices[v.indices[i + 2]];
+
+				AddPolygon(t, 3, Forth::Cross(bv - cv, av - cv));
+			}
 		}
 	};
 } // namespace Forth
\ No newline at end of file
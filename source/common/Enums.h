@@ -49,6 +49,19 @@ namespace Forth
 		VM_Custom = 3,
 	};
 
+	/// <summary> Storage of a vertex attribute uploaded from BufferGL </summary>
+	enum AttributeFormat
+	{
+		/// <summary> 32-bit floats </summary>
+		AF_Float = 0,
+		/// <summary> Normalized 16-bit integers, positions are relative to the buffer bounds </summary>
+		AF_Short = 1,
+		/// <summary> Octahedral-encoded normal in two normalized 16-bit integers </summary>
+		AF_Octahedral = 2,
+		/// <summary> Normalized signed 10:10:10:2 integers in one 32-bit word </summary>
+		AF_Packed = 3,
+	};
+
 	/// <summary> Space relatives for transformations </summary>
 	enum Space4
 	{
@@ -0,0 +1,484 @@
+#include "MeshFile.h"
+#include "../extras/Parallel.h"
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Forth
+{
+	static const char _magic[4] = {'F', '4', 'M', 'B'};
+	static const uint32_t _version = 1;
+
+	static inline uint64_t AlignUp(uint64_t v)
+	{
+		return (v + 15) & ~(uint64_t)15;
+	}
+
+	///
+	/// Read-only view of a whole file, mapped when the platform allows it.
+	///
+	class MappedFile
+	{
+	  public:
+		const void *data = NULL;
+		size_t size = 0;
+
+		bool Open(const char *path)
+		{
+#if defined(_WIN32)
+			file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER length;
+			if (!GetFileSizeEx(file, &length))
+				return false;
+			size = (size_t)length.QuadPart;
+			if (size == 0)
+				return true;
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (!mapping)
+				return false;
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			return data != NULL;
+#elif defined(__unix__) || defined(__APPLE__)
+			fd = open(path, O_RDONLY);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0)
+				return false;
+			size = (size_t)st.st_size;
+			if (size == 0)
+				return true;
+			void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED)
+				return false;
+			data = p;
+			return true;
+#else
+			std::ifstream stream(path, std::ios::binary | std::ios::ate);
+			if (!stream)
+				return false;
+			size = (size_t)stream.tellg();
+			buffer.resize(size);
+			stream.seekg(0);
+			stream.read(buffer.data(), size);
+			data = buffer.data();
+			return (bool)stream;
+#endif
+		}
+
+		~MappedFile(void)
+		{
+#if defined(_WIN32)
+			if (data)
+				UnmapViewOfFile(data);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+#elif defined(__unix__) || defined(__APPLE__)
+			if (data)
+				munmap((void *)data, size);
+			if (fd >= 0)
+				close(fd);
+#endif
+		}
+
+	  private:
+#if defined(_WIN32)
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = NULL;
+#elif defined(__unix__) || defined(__APPLE__)
+		int fd = -1;
+#else
+		std::vector<char> buffer;
+#endif
+	};
+
+	// Same as Buffer4::GetBounds(), over transformed vertices
+	static SphereBounds4 GetBounds(const Buffer4 &source, const Transform4 &transform)
+	{
+		if (source.verticeCount == 0)
+			return SphereBounds4();
+
+		const Vector4 first = transform * source.vertices[0];
+		Bounds4 box(first, first);
+		for (int i = 1; i < source.verticeCount; i++)
+			box.Allocate(transform * source.vertices[i]);
+
+		const Vector4 center = box.center();
+		float radius = 0;
+		for (int i = 0; i < source.verticeCount; i++)
+			radius = Max(radius, DistanceSq(center, transform * source.vertices[i]));
+
+		return SphereBounds4(center, Sqrt(radius));
+	}
+
+	bool ReadMeshFile(const void *data, size_t size, Buffer4 &dest, SphereBounds4 *bounds)
+	{
+		MeshFileHeader h;
+		if (size < sizeof(h))
+			return false;
+		memcpy(&h, data, sizeof(h));
+
+		if (memcmp(h.magic, _magic, 4) != 0 || h.version != _version || h.simplex > SM_Tetrahedron)
+			return false;
+
+		// Blocks must lie within the file and fit in Buffer4's int counts
+		const uint64_t vbytes = h.vertexCount * sizeof(Vector4), ibytes = h.indexCount * sizeof(int);
+		if (h.vertexCount > INT_MAX || h.indexCount > INT_MAX ||
+			h.vertexOffset > size || vbytes > size - h.vertexOffset ||
+			h.indexOffset > size || ibytes > size - h.indexOffset ||
+			h.indexCount % (h.simplex + 1) != 0)
+			return false;
+
+		const char *bytes = (const char *)data;
+		const int *indices = (const int *)(bytes + h.indexOffset);
+
+		dest.Clear();
+		dest.EnsureVertices((int)h.vertexCount);
+		dest.EnsureIndices((int)h.indexCount);
+
+		memcpy(dest.vertices, bytes + h.vertexOffset, (size_t)vbytes);
+		memcpy(dest.indices, indices, (size_t)ibytes);
+		dest.verticeCount = (int)h.vertexCount;
+		dest.indiceCount = (int)h.indexCount;
+		dest.simplex = (SimplexMode)h.simplex;
+
+		// Out of range indices would be read blindly by projectors
+		for (int i = 0; i < dest.indiceCount; i++)
+		{
+			if ((unsigned int)dest.indices[i] >= (unsigned int)dest.verticeCount)
+			{
+				dest.Clear();
+				return false;
+			}
+		}
+
+		if (dest.HasLanes())
+			dest.SyncLanes();
+		dest.Touch();
+
+		if (bounds && (h.flags & MF_Bounds))
+			*bounds = SphereBounds4(Vector4(h.center[0], h.center[1], h.center[2], h.center[3]), h.radius);
+
+		return true;
+	}
+
+	bool ReadMeshFile(const char *path, Buffer4 &dest, SphereBounds4 *bounds)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+		return ReadMeshFile(file.data, file.size, dest, bounds);
+	}
+
+	///
+	/// Output of one chunk of OBJ text.
+	///
+	struct OBJChunk
+	{
+		std::vector<Vector4> vertices;
+		std::vector<int> indices;
+		int arity = 0; // Indices per face, -1 if faces disagree
+		bool valid = true;
+	};
+
+	static inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	static const double _pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+									1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	// Parse a float at p (not past end), moving p after it. Returns false if there's none.
+	// Parse the token at p with the standard library
+	static bool ParseFloatSlow(const char *&p, const char *end, float *out)
+	{
+		char buffer[64];
+		int n = 0;
+		while (p < end && !IsBlank(*p) && *p != '\n' && n < 63)
+			buffer[n++] = *p++;
+		buffer[n] = 0;
+		char *stop;
+		*out = strtof(buffer, &stop);
+		return n > 0 && stop == buffer + n;
+	}
+
+	static bool ParseFloat(const char *&p, const char *end, float *out)
+	{
+		const char *start = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		uint64_t mantissa = 0;
+		int digits = 0, exponent = 0;
+		bool any = false;
+
+		for (; p < end && *p >= '0' && *p <= '9'; p++, any = true)
+		{
+			if (digits < 19)
+				mantissa = mantissa * 10 + (*p - '0'), digits += mantissa > 0;
+			else
+				exponent++;
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true)
+			{
+				if (digits < 19)
+					mantissa = mantissa * 10 + (*p - '0'), digits += mantissa > 0, exponent--;
+			}
+		}
+
+		if (any && p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char *q = p + 1;
+			bool eneg = false;
+			if (q < end && (*q == '-' || *q == '+'))
+				eneg = *q++ == '-';
+			if (q < end && *q >= '0' && *q <= '9')
+			{
+				int e = 0;
+				for (; q < end && *q >= '0' && *q <= '9'; q++)
+					e = Min(e * 10 + (*q - '0'), 10000);
+				exponent += eneg ? -e : e;
+				p = q;
+			}
+		}
+
+		// Something unusual (inf, nan, hex...), or more digits than a double holds exactly
+		if (!any || (p < end && !IsBlank(*p) && *p != '\n') || mantissa > (1ULL << 53) || exponent < -22 || exponent > 22)
+		{
+			p = start;
+			return ParseFloatSlow(p, end, out);
+		}
+
+		// Both the mantissa and the power of ten are exact, so this is the correctly rounded double
+		double v = (double)mantissa;
+		if (exponent < 0)
+			v /= _pow10[-exponent];
+		else
+			v *= _pow10[exponent];
+
+		// Rounding that double to float again is only off when it lies exactly halfway between two floats.
+		// Nonzero values here range from 1e-22 to 2^53 * 1e22, so the float is never denormal nor infinite.
+		uint64_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		if ((bits & ((1ULL << 29) - 1)) == (1ULL << 28))
+		{
+			p = start;
+			return ParseFloatSlow(p, end, out);
+		}
+
+		*out = (float)(negative ? -v : v);
+		return true;
+	}
+
+	// Parse a non-negative int at p, skipping anything attached to it (e.g. "1/2/3")
+	static bool ParseIndex(const char *&p, const char *end, int *out)
+	{
+		if (p >= end || *p < '0' || *p > '9')
+			return false;
+
+		int64_t v = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+			v = Min<int64_t>(v * 10 + (*p - '0'), INT_MAX);
+
+		while (p < end && !IsBlank(*p) && *p != '\n')
+			p++;
+
+		*out = (int)v;
+		return true;
+	}
+
+	static void ParseOBJChunk(const char *p, const char *end, OBJChunk &chunk)
+	{
+		while (p < end)
+		{
+			while (p < end && IsBlank(*p))
+				p++;
+
+			const bool vertex = p + 1 < end && p[0] == 'v' && IsBlank(p[1]);
+			const bool face = p + 1 < end && p[0] == 'f' && IsBlank(p[1]);
+
+			if (vertex || face)
+			{
+				p += 2;
+				float f[4] = {0, 0, 0, 0};
+				int ids[4], n = 0;
+
+				while (true)
+				{
+					while (p < end && IsBlank(*p))
+						p++;
+					if (p >= end || *p == '\n' || *p == '#')
+						break;
+
+					if (n == 4 || !(vertex ? ParseFloat(p, end, f + n) : ParseIndex(p, end, ids + n)))
+					{
+						chunk.valid = false;
+						return;
+					}
+					n++;
+				}
+
+				if (vertex)
+					chunk.vertices.push_back(Vector4(f[0], f[1], f[2], f[3]));
+				else if (n > 0)
+				{
+					chunk.arity = chunk.arity == 0 || chunk.arity == n ? n : -1;
+					chunk.indices.insert(chunk.indices.end(), ids, ids + n);
+				}
+			}
+
+			// Eat up the rest of the line (comments and unknown statements included)
+			while (p < end && *p != '\n')
+				p++;
+			p++;
+		}
+	}
+
+	bool ReadMeshOBJ(const char *data, size_t size, Buffer4 &dest, int threads)
+	{
+		// Not worth a thread below a megabyte or so
+		const int count = (int)Min<size_t>((size_t)ThreadCount(threads), size / (1 << 20) + 1);
+
+		// Chunk boundaries, each moved forward to the next line start
+		std::vector<size_t> bounds(count + 1, size);
+		bounds[0] = 0;
+		for (int i = 1; i < count; i++)
+		{
+			size_t b = Max(bounds[i - 1], size * i / count);
+			while (b < size && b > 0 && data[b - 1] != '\n')
+				b++;
+			bounds[i] = b;
+		}
+
+		std::vector<OBJChunk> chunks(count);
+		ParallelInvoke(count, [&](int i) {
+			ParseOBJChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+		});
+
+		int arity = 0;
+		size_t vertices = 0, indices = 0;
+		for (const OBJChunk &c : chunks)
+		{
+			if (!c.valid || c.arity < 0 || (arity && c.arity && arity != c.arity))
+				return false;
+			arity = Max(arity, c.arity);
+			vertices += c.vertices.size();
+			indices += c.indices.size();
+		}
+
+		if (vertices > INT_MAX || indices > INT_MAX)
+			return false;
+
+		dest.Clear();
+		dest.EnsureVertices((int)vertices);
+		dest.EnsureIndices((int)indices);
+
+		// Copy every chunk to its place at once
+		std::vector<size_t> vstart(count + 1, 0), istart(count + 1, 0);
+		for (int i = 0; i < count; i++)
+		{
+			vstart[i + 1] = vstart[i] + chunks[i].vertices.size();
+			istart[i + 1] = istart[i] + chunks[i].indices.size();
+		}
+
+		ParallelInvoke(count, [&](int i) {
+			if (!chunks[i].vertices.empty())
+				memcpy(dest.vertices + vstart[i], chunks[i].vertices.data(), chunks[i].vertices.size() * sizeof(Vector4));
+			if (!chunks[i].indices.empty())
+				memcpy(dest.indices + istart[i], chunks[i].indices.data(), chunks[i].indices.size() * sizeof(int));
+		});
+
+		dest.verticeCount = (int)vertices;
+		dest.indiceCount = (int)indices;
+		if (arity > 0)
+			dest.simplex = (SimplexMode)(arity - 1);
+
+		for (int i = 0; i < dest.indiceCount; i++)
+		{
+			if (dest.indices[i] >= dest.verticeCount)
+			{
+				dest.Clear();
+				return false;
+			}
+		}
+
+		if (dest.HasLanes())
+			dest.SyncLanes();
+		dest.Touch();
+		return true;
+	}
+
+	bool WriteMeshFile(std::ostream &stream, const Buffer4 &source, const Transform4 *transform, bool bounds)
+	{
+		MeshFileHeader h;
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, _magic, 4);
+		h.version = _version;
+		h.simplex = (uint32_t)source.simplex;
+		h.vertexCount = (uint64_t)source.verticeCount;
+		h.vertexOffset = AlignUp(sizeof(h));
+		h.indexCount = (uint64_t)source.indiceCount;
+		h.indexOffset = AlignUp(h.vertexOffset + h.vertexCount * sizeof(Vector4));
+
+		// Transformed vertices go through a fixed size chunk, so source is left untouched
+		const int chunk = 4096;
+		std::vector<Vector4> temp;
+		if (transform)
+			temp.resize(Min(chunk, source.verticeCount));
+
+		if (bounds)
+		{
+			const SphereBounds4 b = transform ? GetBounds(source, *transform) : source.GetBounds();
+			h.flags |= MF_Bounds;
+			h.center[0] = b.center.x;
+			h.center[1] = b.center.y;
+			h.center[2] = b.center.z;
+			h.center[3] = b.center.w;
+			h.radius = b.radius;
+		}
+
+		static const char padding[16] = {};
+		stream.write((const char *)&h, sizeof(h));
+		stream.write(padding, (std::streamsize)(h.vertexOffset - sizeof(h)));
+
+		if (transform)
+		{
+			for (int i = 0; i < source.verticeCount; i += chunk)
+			{
+				const int n = Min(chunk, source.verticeCount - i);
+				for (int j = 0; j < n; j++)
+					temp[j] = *transform * source.vertices[i + j];
+				stream.write((const char *)temp.data(), n * sizeof(Vector4));
+			}
+		}
+		else
+			stream.write((const char *)source.vertices, source.verticeCount * sizeof(Vector4));
+
+		stream.write(padding, (std::streamsize)(h.indexOffset - h.vertexOffset - h.vertexCount * sizeof(Vector4)));
+		stream.write((const char *)source.indices, source.indiceCount * sizeof(int));
+
+		return (bool)stream;
+	}
+} // namespace Forth
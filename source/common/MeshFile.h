@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../math/SphereBounds4.h"
+#include "../math/Transform4.h"
+#include "Buffer4.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace Forth
+{
+	/// <summary> Optional blocks of a mesh file </summary>
+	enum MeshFileFlags
+	{
+		/// <summary> Header holds the bounding sphere of vertices </summary>
+		MF_Bounds = 1,
+	};
+
+	///
+	/// Header of the binary 4D mesh format, written as is (little endian).
+	///
+	/// The header is followed by the vertex block (x, y, z, w floats per vertex),
+	/// then the index block (32-bit ints, simplex + 1 per simplex), both 16 bytes aligned
+	/// so a mapped file can be copied (or read) in place.
+	///
+	struct MeshFileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t simplex;
+		uint32_t flags;
+		uint64_t vertexCount, vertexOffset;
+		uint64_t indexCount, indexOffset;
+		float center[4];
+		float radius;
+		uint32_t reserved[3];
+	};
+
+	static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader must be packed");
+	static_assert(sizeof(Vector4) == 4 * sizeof(float), "Vector4 must be 4 floats");
+
+	/// <summary>
+	/// Load a mesh file already in memory into dest, with one copy per block.
+	/// Bounds are written if given and present in the file. Returns false on malformed data.
+	/// </summary>
+	bool ReadMeshFile(const void *data, size_t size, Buffer4 &dest, SphereBounds4 *bounds = NULL);
+
+	/// <summary>
+	/// Map a mesh file and load it into dest. Returns false if it can't be opened or is malformed.
+	/// </summary>
+	bool ReadMeshFile(const char *path, Buffer4 &dest, SphereBounds4 *bounds = NULL);
+
+	/// <summary>
+	/// Parse the text format of Model4::WriteStreamOBJ() into dest, split across threads.
+	/// </summary>
+	/// <remarks>
+	/// Faces take as many indices as their line holds (simplex + 1), which must agree across the file.
+	/// Zero or less threads uses all hardware threads. Returns false on malformed data.
+	/// </remarks>
+	bool ReadMeshOBJ(const char *data, size_t size, Buffer4 &dest, int threads = 0);
+
+	/// <summary>
+	/// Write source as a mesh file, optionally transforming vertices and storing their bounds.
+	/// </summary>
+	bool WriteMeshFile(std::ostream &stream, const Buffer4 &source, const Transform4 *transform = NULL, bool bounds = true);
+} // namespace Forth
@@ -0,0 +1,117 @@
+#include "SimplexAdjacency.h"
+#include "Buffer4.h"
+
+namespace Forth
+{
+	// Sorted vertices of face f (the one opposite to its vertex), returning their amount
+	static inline int FaceVertices(const int *t, int stride, int f, int *v)
+	{
+		const int i = f - f % stride, k = f % stride;
+		int n = 0;
+		for (int j = 0; j < stride; j++)
+			if (j != k)
+				v[n++] = t[i + j];
+		std::sort(v, v + n);
+		return n;
+	}
+
+	static inline uint64_t FaceKey(const int *v, int n)
+	{
+		uint64_t k = 0x9E3779B97F4A7C15ULL;
+		for (int j = 0; j < n; j++)
+			k = (k ^ (uint32_t)v[j]) * 0xC2B2AE3D27D4EB4FULL;
+		return k;
+	}
+
+	void SimplexAdjacency::Build(const Buffer4 &source)
+	{
+		stride = source.simplex + 1;
+		indices = 0;
+		neighbors.clear();
+
+		open.reset(new IntHashMap());
+		// Most faces are matched right away, so half of them are open at once at most
+		open->Reserve(source.indiceCount / 2);
+
+		Extend(source);
+	}
+
+	void SimplexAdjacency::Extend(const Buffer4 &source)
+	{
+		if (!open || stride != source.simplex + 1)
+		{
+			Build(source);
+			return;
+		}
+
+		const int end = source.indiceCount - source.indiceCount % stride;
+		neighbors.resize(end, -1);
+
+		for (int f = indices; f < end; f++)
+			Match(source.indices, f);
+
+		indices = end;
+		Compact(source.indices);
+	}
+
+	void SimplexAdjacency::Update(const Buffer4 &source)
+	{
+		if (source.indiceCount < indices || stride != source.simplex + 1)
+			Build(source);
+		else if (source.indiceCount - source.indiceCount % stride > indices)
+			Extend(source);
+	}
+
+	void SimplexAdjacency::Match(const int *t, int f)
+	{
+		int v[4], w[4];
+		const int n = FaceVertices(t, stride, f, v);
+
+		// Rehash on the (unlikely) collision of different faces
+		for (uint64_t key = FaceKey(v, n);; key = IntHashMap::Hash(key + 1))
+		{
+			if (key == IntHashMap::Empty)
+				continue;
+
+			bool added;
+			const int g = open->Get(key, f, &added);
+			if (added)
+				return;
+
+			FaceVertices(t, stride, g, w);
+			if (memcmp(v, w, n * sizeof(int)) != 0)
+				continue;
+
+			// A face already linked to another simplex is non-manifold, leave this one on the boundary
+			if (neighbors[g] < 0)
+			{
+				neighbors[g] = f;
+				neighbors[f] = g;
+			}
+			return;
+		}
+	}
+
+	void SimplexAdjacency::Compact(const int *t)
+	{
+		std::vector<int> faces;
+		faces.reserve(open->count);
+		for (int i = 0; i < open->cap; i++)
+			if (open->keys[i] != IntHashMap::Empty && neighbors[open->values[i]] < 0)
+				faces.push_back(open->values[i]);
+
+		// Always from a fresh map, so it shrinks along with the boundary
+		open.reset(new IntHashMap());
+		open->Reserve((int)faces.size());
+		for (int f : faces)
+			Match(t, f);
+	}
+
+	size_t SimplexAdjacency::MemoryUsage(void) const
+	{
+		size_t bytes = (neighbors.capacity() + marks.capacity() + stack.capacity()) * sizeof(int);
+		if (open)
+			bytes += open->cap * (sizeof(uint64_t) + sizeof(int));
+		return bytes;
+	}
+} // namespace Forth
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../extras/HashMap.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace Forth
+{
+	struct Buffer4;
+
+	///
+	/// Face to neighbouring simplex table of a Buffer4, matched by hashing.
+	/// Built once, then extended as simplices are appended.
+	///
+	struct SimplexAdjacency
+	{
+		/// <summary>
+		/// For face k of the simplex starting at i (the one opposite to its k-th vertex),
+		/// the matching face of the neighbour at neighbors[i + k], or -1 on the boundary.
+		/// </summary>
+		/// <remarks>
+		/// Faces are numbered like indices, so the neighbour simplex starts at f - f % stride.
+		/// A face shared by more than two simplices (non-manifold) only links the first two.
+		/// </remarks>
+		std::vector<int> neighbors;
+
+		/// Buffer4::indiceCount this table was built against
+		int indices = 0;
+
+		/// Indices per simplex, Buffer4::simplex + 1
+		int stride = 1;
+
+		/// <summary>
+		/// Rebuild the table from scratch.
+		/// </summary>
+		void Build(const Buffer4 &source);
+
+		/// <summary>
+		/// Match simplices appended since the last call, linking them to the current boundary.
+		/// </summary>
+		void Extend(const Buffer4 &source);
+
+		/// <summary>
+		/// Extend if simplices were appended, rebuild if some were removed, otherwise do nothing.
+		/// </summary>
+		/// <remarks>
+		/// Indices rewritten in place can't be detected, call Build() after that.
+		/// </remarks>
+		void Update(const Buffer4 &source);
+
+		/// <summary>
+		/// Amount of faces waiting for a neighbour (e.g. the boundary of a closed mesh is zero).
+		/// </summary>
+		int BoundaryCount(void) const { return open ? open->count : 0; }
+
+		/// <summary>
+		/// Heap memory held by this table, in bytes.
+		/// </summary>
+		size_t MemoryUsage(void) const;
+
+		/// <summary>
+		/// Visit every simplex reachable from given seeds through faces straddling the sides,
+		/// where side(v) tells on which side of the slice vertex v lies.
+		/// Seeds are simplex starts in given indices (those of the source this table was built against).
+		/// Seeds not crossing the slice are skipped, every other simplex is visited once as visit(i).
+		/// </summary>
+		/// <remarks>
+		/// Only simplices that cross the slice are touched, but each separate piece of the slice needs a seed.
+		/// Not thread safe, as visited marks are kept in the table.
+		/// </remarks>
+		template <class S, class F>
+		void March(const int *t, const int *seeds, int count, S side, F visit);
+
+	  private:
+		/// Faces still waiting for a neighbour, by key
+		std::unique_ptr<IntHashMap> open;
+
+		std::vector<int> marks, stack;
+		int mark = 0;
+
+		// Link face f with a matching open face, or open it
+		void Match(const int *t, int f);
+
+		// Keep only unmatched faces in the map
+		void Compact(const int *t);
+	};
+
+	template <class S, class F>
+	void SimplexAdjacency::March(const int *t, const int *seeds, int count, S side, F visit)
+	{
+		marks.resize(neighbors.size() / stride);
+		if (++mark == 0)
+		{
+			// Wrapped around, stale marks could match again
+			std::fill(marks.begin(), marks.end(), 0);
+			mark = 1;
+		}
+
+		stack.clear();
+		for (int k = 0; k < count; k++)
+			stack.push_back(seeds[k]);
+
+		while (!stack.empty())
+		{
+			const int i = stack.back();
+			stack.pop_back();
+
+			int &m = marks[i / stride];
+			if (m == mark)
+				continue;
+			m = mark;
+
+			bool s[4];
+			int sum = 0;
+			for (int j = 0; j < stride; j++)
+				sum += s[j] = side(t[i + j]);
+
+			if (sum == 0 || sum == stride)
+				continue;
+
+			visit(i);
+
+			// The slice goes on through faces with vertices on both sides,
+			// that is every face but one opposite to a vertex alone on its side
+			for (int k = 0; k < stride; k++)
+			{
+				const int face = sum - s[k], n = neighbors[i + k];
+				if (n >= 0 && face > 0 && face < stride - 1)
+					stack.push_back(n - n % stride);
+			}
+		}
+	}
+} // namespace Forth
@@ -0,0 +1,98 @@
+#include "SimplexTree.h"
+#include "Buffer4.h"
+#include <algorithm>
+
+namespace Forth
+{
+	void SimplexTree::Build(const Buffer4 &source)
+	{
+		const int stride = source.simplex + 1;
+		const int count = source.indiceCount / stride;
+
+		nodes.clear();
+		order.resize(count);
+
+		// Split by simplex centers, bounds are filled by Refit()
+		std::vector<Vector4> centers(count);
+		for (int s = 0; s < count; s++)
+		{
+			Vector4 c = Vector4();
+			for (int j = 0; j < stride; j++)
+				c += source.vertices[source.indices[s * stride + j]];
+			centers[s] = c / (float)stride;
+			order[s] = s * stride;
+		}
+
+		if (count > 0)
+			BuildNode(source, centers, 0, count, 0);
+
+		indices = source.indiceCount;
+		Refit(source);
+	}
+
+	int SimplexTree::BuildNode(const Buffer4 &source, std::vector<Vector4> &centers, int start, int count, int depth)
+	{
+		const int stride = source.simplex + 1;
+		const int index = (int)nodes.size();
+		nodes.push_back(Node());
+
+		// Depth is capped to keep Query()'s stack bounded
+		if (count <= Max(leafSize, 1) || depth >= 48)
+		{
+			nodes[index].start = start;
+			nodes[index].count = count;
+			return index;
+		}
+
+		Bounds4 box(centers[order[start] / stride], centers[order[start] / stride]);
+		for (int i = start + 1; i < start + count; i++)
+			box.Allocate(centers[order[i] / stride]);
+
+		// Median split along the longest axis
+		const int axis = MaxPerElemIdx(box.max - box.min), half = count / 2;
+		std::nth_element(order.begin() + start, order.begin() + start + half, order.begin() + start + count,
+						 [&](int a, int b) { return centers[a / stride][axis] < centers[b / stride][axis]; });
+
+		nodes[index].count = 0;
+		BuildNode(source, centers, start, half, depth + 1);
+		// Nodes may reallocate while building, so no reference is held across the calls
+		const int right = BuildNode(source, centers, start + half, count - half, depth + 1);
+		nodes[index].right = right;
+		return index;
+	}
+
+	void SimplexTree::Refit(const Buffer4 &source)
+	{
+		const int stride = source.simplex + 1;
+		const int *t4 = source.indices;
+		const Vector4 *v4 = source.vertices;
+
+		// Children always come after their parent
+		for (int i = (int)nodes.size(); i-- > 0;)
+		{
+			Node &n = nodes[i];
+			if (n.IsLeaf())
+			{
+				const Vector4 &first = v4[t4[order[n.start]]];
+				n.bounds.Set(first, first);
+				for (int k = n.start; k < n.start + n.count; k++)
+				{
+					for (int j = 0; j < stride; j++)
+						n.bounds.Allocate(v4[t4[order[k] + j]]);
+				}
+			}
+			else
+				n.bounds = Combine(nodes[i + 1].bounds, nodes[n.right].bounds);
+		}
+
+		version = source.version;
+	}
+
+	void SimplexTree::Update(const Buffer4 &source)
+	{
+		if (indices != source.indiceCount)
+			Build(source);
+		else if (version != source.version)
+			Refit(source);
+	}
+} // namespace Forth
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../math/Bounds4.h"
+#include <climits>
+#include <vector>
+
+namespace Forth
+{
+	struct Buffer4;
+
+	///
+	/// Static bounding volume hierarchy over simplices of a Buffer4.
+	/// Built once, then refitted when vertices move.
+	///
+	struct SimplexTree
+	{
+		struct Node
+		{
+			Bounds4 bounds;
+			/// Range in order (leaf only)
+			int start, count;
+			/// Index of the right child, left child is always the next node (branch only)
+			int right;
+
+			bool IsLeaf(void) const { return count > 0; }
+		};
+
+		/// Nodes in depth-first order, the first is the root
+		std::vector<Node> nodes;
+
+		/// Simplex indices (start of each simplex in Buffer4::indices), grouped by leaf
+		std::vector<int> order;
+
+		/// Maximum simplices per leaf
+		int leafSize = 8;
+
+		/// Buffer4::version this tree was fitted against
+		unsigned long version = ULONG_MAX;
+
+		/// Buffer4::indiceCount this tree was built against
+		int indices = -1;
+
+		/// <summary>
+		/// Rebuild the hierarchy from scratch.
+		/// </summary>
+		void Build(const Buffer4 &source);
+
+		/// <summary>
+		/// Recompute node bounds from current vertices, keeping the hierarchy.
+		/// </summary>
+		void Refit(const Buffer4 &source);
+
+		/// <summary>
+		/// Rebuild if simplices changed, refit if only vertices changed, otherwise do nothing.
+		/// </summary>
+		void Update(const Buffer4 &source);
+
+		/// <summary>
+		/// Visit leaves whose bounds straddle the plane Dot(normal, p) + distance = 0.
+		/// Callback receives the leaf simplices as (const int *simplices, int count).
+		/// </summary>
+		template <class F>
+		void Query(const Vector4 &normal, float distance, F callback) const
+		{
+			if (nodes.empty())
+				return;
+
+			const Vector4 absNormal = Abs(normal);
+			int stack[64], top = 0;
+			stack[top++] = 0;
+
+			while (top > 0)
+			{
+				const int i = stack[--top];
+				const Node &n = nodes[i];
+				const Vector4 c = n.bounds.center();
+
+				// Padded a bit so rounding never skips vertices lying on the plane
+				float d = Abs(Dot(normal, c) + distance), r = Dot(absNormal, n.bounds.extent());
+				if (d - r > (d + r) * 1e-5f + 1e-6f)
+					continue;
+
+				if (n.IsLeaf())
+					callback(&order[n.start], n.count);
+				else
+				{
+					stack[top++] = n.right;
+					stack[top++] = i + 1;
+				}
+			}
+		}
+
+	  private:
+		int BuildNode(const Buffer4 &source, std::vector<Vector4> &centers, int start, int count, int depth);
+	};
+} // namespace Forth
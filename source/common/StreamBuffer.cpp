@@ -0,0 +1,104 @@
+#include "StreamBuffer.h"
+
+namespace Forth
+{
+	StreamBuffer::StreamBuffer(StreamTarget &target, int capacity, int segments)
+		: target(&target), capacity(capacity), segments(Max(1, Min(segments, 8)))
+	{
+		fenced.assign(this->segments, false);
+	}
+
+	void StreamBuffer::Reallocate(int size)
+	{
+		// Keep every segment 16 bytes aligned
+		capacity = (size / segments + 15) / 16 * 16 * segments;
+		mapped = (char *)target->Allocate(capacity);
+		allocated = true;
+		generation++;
+
+		// Fresh storage isn't read by anything yet
+		fenced.assign(segments, false);
+		segment = head = 0;
+		limit = capacity / segments;
+	}
+
+	int StreamBuffer::Bytes(const BufferGL &buffer, bool indices)
+	{
+		// Every write starts 16 bytes aligned
+		int bytes = (buffer.vb_count * (int)sizeof(float) + 15) & ~15;
+		if (indices)
+			bytes += (buffer.IndexBytes() + 15) & ~15;
+		return bytes;
+	}
+
+	void StreamBuffer::Begin(int bytes)
+	{
+		// Grow before anything is written, so no offset of this frame gets orphaned
+		const int frame = Max(bytes, outgrown);
+		if (!allocated)
+			Reallocate(Max(capacity, frame * segments));
+		else if (frame > capacity / segments)
+			Reallocate(Max(capacity * 2, frame * segments));
+		outgrown = 0;
+
+		if (fenced[segment])
+		{
+			target->Wait(segment);
+			fenced[segment] = false;
+		}
+
+		head = segment * (capacity / segments);
+		limit = head + capacity / segments;
+	}
+
+	int StreamBuffer::Push(const BufferGL &buffer)
+	{
+		return Write(buffer.vb, buffer.vb_count * (int)sizeof(float));
+	}
+
+	int StreamBuffer::PushIndices(const BufferGL &buffer)
+	{
+		return Write(buffer.ib, buffer.IndexBytes());
+	}
+
+	int StreamBuffer::Write(const void *data, int bytes)
+	{
+		int offset = (head + 15) & ~15;
+
+		if (offset + bytes > limit)
+		{
+			// Outgrown, remember how much the whole frame takes so the next one fits
+			head = offset + bytes;
+			outgrown = head - (limit - capacity / segments);
+			return -1;
+		}
+
+		// Empty buffers may have no data at all
+		if (bytes > 0)
+		{
+			if (mapped)
+				memcpy(mapped + offset, data, bytes);
+			else
+				target->Upload(offset, bytes, data);
+		}
+
+		head = offset + bytes;
+		return offset;
+	}
+
+	void StreamBuffer::End(void)
+	{
+		if (mapped)
+		{
+			// The GPU may still read this segment when the ring comes back to it
+			target->Fence(segment);
+			fenced[segment] = true;
+		}
+
+		segment = (segment + 1) % segments;
+
+		// Unmapped storage is orphaned instead, letting the driver hand out fresh memory
+		if (!mapped && segment == 0)
+			Reallocate(capacity);
+	}
+} // namespace Forth
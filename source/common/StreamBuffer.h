@@ -0,0 +1,218 @@
+#pragma once
+
+#include "BufferGL.h"
+#include <vector>
+
+namespace Forth
+{
+	///
+	/// Abstract destination of streamed vertex data (e.g. a GL vertex buffer)
+	///
+	struct StreamTarget
+	{
+		virtual ~StreamTarget(void) {}
+
+		/// <summary>
+		/// (Re)create storage of given size in bytes, dropping the old one.
+		/// Return persistently mapped memory, or NULL if writes must go through Upload().
+		/// </summary>
+		virtual void *Allocate(int size) = 0;
+
+		/// <summary>
+		/// Copy size bytes of data into storage at offset (unmapped storage only).
+		/// </summary>
+		virtual void Upload(int offset, int size, const void *data) = 0;
+
+		/// <summary>
+		/// Mark the point after which the GPU no longer reads given segment.
+		/// </summary>
+		virtual void Fence(int /*segment*/) {}
+
+		/// <summary>
+		/// Block until the GPU passed the fence of given segment.
+		/// </summary>
+		virtual void Wait(int /*segment*/) {}
+	};
+
+	///
+	/// In-memory stand-in of StreamTarget, recording what would be sent to the GPU.
+	///
+	struct MemoryStreamTarget : public StreamTarget
+	{
+		std::vector<char> storage;
+
+		/// Pretend storage is persistently mapped
+		bool persistent;
+
+		int allocations = 0, uploads = 0, fences = 0, waits = 0;
+
+		MemoryStreamTarget(bool persistent = true) : persistent(persistent) {}
+
+		void *Allocate(int size) override
+		{
+			allocations++;
+			storage.assign(size, 0);
+			return persistent ? storage.data() : NULL;
+		}
+
+		void Upload(int offset, int size, const void *data) override
+		{
+			uploads++;
+			memcpy(storage.data() + offset, data, size);
+		}
+
+		void Fence(int) override { fences++; }
+
+		void Wait(int) override { waits++; }
+	};
+
+	///
+	/// Ring of vertex data streamed into one StreamTarget, split into per-frame segments.
+	///
+	/// When the target is persistently mapped, BufferGL contents are copied straight into it,
+	/// and a segment is only reused after the GPU passed its fence.
+	/// Otherwise they go through Upload(), and the storage is orphaned each time the ring wraps.
+	///
+	class StreamBuffer
+	{
+		StreamTarget *target;
+		char *mapped = NULL;
+
+		int capacity, segments;
+		int segment = 0, head = 0, limit = 0;
+		std::vector<bool> fenced;
+		bool allocated = false;
+		int generation = 0;
+		// Bytes the last frame wanted when it outgrew its segment
+		int outgrown = 0;
+
+		void Reallocate(int size);
+
+		int Write(const void *data, int bytes);
+
+	  public:
+		/// <summary>
+		/// Capacity is in bytes, split evenly between segments (frames in flight, up to 8).
+		/// </summary>
+		StreamBuffer(StreamTarget &target, int capacity = 1 << 22, int segments = 3);
+
+		/// <summary>
+		/// Bytes taken by Push() of the buffer, and PushIndices() too if asked, alignment included.
+		/// </summary>
+		static int Bytes(const BufferGL &buffer, bool indices = false);
+
+		/// <summary>
+		/// Start a frame of given size in bytes (sum of Bytes() of what will be pushed),
+		/// growing the ring first if needed, then waiting for the GPU to release the segment about to be reused.
+		/// </summary>
+		void Begin(int bytes = 0);
+
+		/// <summary>
+		/// Write the buffer's vertices into current segment and return their byte offset.
+		/// </summary>
+		/// <remarks>
+		/// Storage never moves within a frame. Once a frame outgrows its segment, this and every later push
+		/// of the frame return -1 without writing anything, and the next Begin() grows the ring to fit.
+		/// Give Begin() the frame size to avoid this.
+		/// </remarks>
+		int Push(const BufferGL &buffer);
+
+		/// <summary>
+		/// Same as Push(), for the buffer's (packed) indices.
+		/// </summary>
+		int PushIndices(const BufferGL &buffer);
+
+		/// <summary>
+		/// End a frame, once every draw reading it is issued.
+		/// </summary>
+		void End(void);
+
+		/// <summary>
+		/// Incremented every time the storage is (re)allocated, which only happens in Begin() and End().
+		/// </summary>
+		int Generation(void) const { return generation; }
+
+		int Capacity(void) const { return capacity; }
+	};
+} // namespace Forth
+
+#if defined(GL_ARRAY_BUFFER)
+
+namespace Forth
+{
+	///
+	/// StreamTarget over a GL vertex buffer.
+	/// Only available when GL headers are included before this one.
+	///
+	struct GLStreamTarget : public StreamTarget
+	{
+		GLuint vb = 0;
+
+		/// Use immutable, persistently mapped storage when available
+		bool persistent = true;
+
+#if defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+		GLsync syncs[8] = {};
+#endif
+
+		GLStreamTarget(void) { glGenBuffers(1, &vb); }
+
+		~GLStreamTarget(void)
+		{
+#if defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+			for (GLsync &s : syncs)
+				if (s)
+					glDeleteSync(s);
+#endif
+			glDeleteBuffers(1, &vb);
+		}
+
+		void *Allocate(int size) override
+		{
+#if defined(GL_MAP_PERSISTENT_BIT)
+			if (persistent)
+			{
+				// Immutable storage can't be resized, so start over with a new buffer
+				glDeleteBuffers(1, &vb);
+				glGenBuffers(1, &vb);
+				glBindBuffer(GL_ARRAY_BUFFER, vb);
+
+				const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+				return glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+			}
+#endif
+			// Orphan
+			glBindBuffer(GL_ARRAY_BUFFER, vb);
+			glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+			return NULL;
+		}
+
+		void Upload(int offset, int size, const void *data) override
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, vb);
+			glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+		}
+
+#if defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+		void Fence(int segment) override
+		{
+			if (syncs[segment])
+				glDeleteSync(syncs[segment]);
+			syncs[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+
+		void Wait(int segment) override
+		{
+			if (!syncs[segment])
+				return;
+			while (glClientWaitSync(syncs[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+				;
+			glDeleteSync(syncs[segment]);
+			syncs[segment] = 0;
+		}
+#endif
+	};
+} // namespace Forth
+
+#endif
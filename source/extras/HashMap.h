@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Utils.h"
+#include <cstdint>
+
+namespace Forth
+{
+	///
+	/// Open addressing hash map from 64-bit keys to ints.
+	/// Meant to be cleared and refilled every frame without touching the heap.
+	///
+	struct IntHashMap
+	{
+		/// Reserved key for empty slots
+		static const uint64_t Empty = ~(uint64_t)0;
+
+		uint64_t *keys = NULL;
+		int *values = NULL;
+		int cap = 0;
+		int count = 0;
+
+		IntHashMap(void) { Resize(16); }
+
+		IntHashMap(const IntHashMap &) = delete;
+		IntHashMap &operator=(const IntHashMap &) = delete;
+
+		~IntHashMap(void)
+		{
+			delete[] keys;
+			delete[] values;
+		}
+
+		void Clear(void)
+		{
+			memset(keys, 0xFF, cap * sizeof(uint64_t));
+			count = 0;
+		}
+
+		/// <summary>
+		/// Make sure given amount of keys fits without rehashing.
+		/// </summary>
+		void Reserve(int n)
+		{
+			int c = cap;
+			while (n * 2 > c)
+				c <<= 1;
+			if (c != cap)
+				Resize(c);
+		}
+
+		/// <summary>
+		/// Find the value for given key, or -1 if missing.
+		/// </summary>
+		int Find(uint64_t key) const
+		{
+			for (int i = Hash(key) & (cap - 1);; i = (i + 1) & (cap - 1))
+			{
+				if (keys[i] == key)
+					return values[i];
+				if (keys[i] == Empty)
+					return -1;
+			}
+		}
+
+		/// <summary>
+		/// Get the value slot for given key, inserting it with given value if missing.
+		/// </summary>
+		int &Get(uint64_t key, int value, bool *added)
+		{
+			if ((count + 1) * 2 > cap)
+				Resize(cap << 1);
+
+			for (int i = Hash(key) & (cap - 1);; i = (i + 1) & (cap - 1))
+			{
+				if (keys[i] == key)
+				{
+					*added = false;
+					return values[i];
+				}
+				if (keys[i] == Empty)
+				{
+					keys[i] = key;
+					values[i] = value;
+					count++;
+					*added = true;
+					return values[i];
+				}
+			}
+		}
+
+		static uint64_t Hash(uint64_t k)
+		{
+			// Murmur3 finalizer
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdULL;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ULL;
+			k ^= k >> 33;
+			return k;
+		}
+
+		/// <summary>
+		/// Order independent key for an edge between two vertex indices.
+		/// </summary>
+		static uint64_t EdgeKey(int a, int b)
+		{
+			return a < b ? ((uint64_t)(uint32_t)a << 32) | (uint32_t)b
+						 : ((uint64_t)(uint32_t)b << 32) | (uint32_t)a;
+		}
+
+	  private:
+		void Resize(int newCap)
+		{
+			uint64_t *oldKeys = keys;
+			int *oldValues = values;
+			int oldCap = cap;
+
+			keys = Allocate<uint64_t>(cap = newCap);
+			values = Allocate<int>(cap);
+			memset(keys, 0xFF, cap * sizeof(uint64_t));
+			count = 0;
+
+			for (int i = 0; i < oldCap; i++)
+			{
+				if (oldKeys[i] != Empty)
+				{
+					bool added;
+					Get(oldKeys[i], oldValues[i], &added);
+				}
+			}
+
+			delete[] oldKeys;
+			delete[] oldValues;
+		}
+	};
+} // namespace Forth
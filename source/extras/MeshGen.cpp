@@ -1,4 +1,5 @@
 #include "MeshGen.h"
+#include "../math/Simd4.h"
 #include "../math/Vector4.h"
 #include <cmath>
 
@@ -414,7 +415,7 @@ namespace Forth
 		float _R = scale / (_GR * _GR);
 		for (int i = 0; i < input.verticeCount; i++)
 		{
-			input.vertices[i] *= _R;
+			input.SetVertex(i, input.vertices[i] * _R);
 		}
 
 		// These list starts from one, hence shift back -1
@@ -577,7 +578,7 @@ namespace Forth
 		// Normalize
 		for (int i = 0; i < input.verticeCount; i++)
 		{
-			input.vertices[i] = input.vertices[i] * (scale / 2.f);
+			input.SetVertex(i, input.vertices[i] * (scale / 2.f));
 		}
 
 		// Magic cell-table: http://web.archive.org/web/20091024133911/http://homepages.cwi.nl/~dik/english/mathematics/poly/db/3,3,5/c/s-1.html
@@ -1187,4 +1188,33 @@ namespace Forth
 		// clang-format on
 	}
 
+	void MeshGen::Transform(Buffer4 &input, const Transform4 &transform, bool realign)
+	{
+		int i = input.offset;
+
+		if (input.HasLanes())
+		{
+			// Stream straight from the lanes, no transpose needed
+			const TransformLanes4 m(transform);
+			for (; i + LaneWidth <= input.verticeCount; i += LaneWidth)
+			{
+				VectorLanes4 v = m * LoadLanes(input.lanes, i);
+				StoreLanes(input.lanes, i, v);
+				StoreLanes(input.vertices + i, v);
+			}
+
+			for (; i < input.verticeCount; i++)
+				input.SetVertex(i, transform * input.vertices[i]);
+		}
+		else
+		{
+			TransformBatch(transform, input.vertices + i, input.vertices + i, input.verticeCount - i);
+			input.Touch();
+		}
+
+		if (realign)
+		{
+			input.Align();
+		}
+	}
 } // namespace Forth
\ No newline at end of file
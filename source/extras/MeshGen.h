@@ -150,17 +150,6 @@ namespace Forth
 				input.SequenceGrid(state.subdiv * 2 + 1, state.subdiv + 1, state.subdiv + 1);
 		}
 
-		static void Transform(Buffer4 &input, const Transform4& transform, bool realign = true)
-		{
-			for(int i = input.verticeCount; i-- > input.offset;)
-			{
-				input.vertices[i] = transform * input.vertices[i];
-			}
-
-			if (realign)
-			{
-				input.Align();
-			}
-		}
+		static void Transform(Buffer4 &input, const Transform4& transform, bool realign = true);
 	};
 } // namespace Forth
\ No newline at end of file
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Utils.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Forth
+{
+	///
+	/// Resolve requested worker count. Zero or less picks the hardware concurrency.
+	///
+	inline int ThreadCount(int requested)
+	{
+		if (requested > 0)
+			return requested;
+
+		int hw = (int)std::thread::hardware_concurrency();
+		return hw > 0 ? hw : 1;
+	}
+
+	///
+	/// Run job(i) for each i in [0, count) concurrently and wait for all of them.
+	/// The calling thread takes the first job.
+	///
+	template <typename F>
+	void ParallelInvoke(int count, F job)
+	{
+		std::vector<std::thread> pool;
+		pool.reserve(count > 1 ? count - 1 : 0);
+
+		for (int i = 1; i < count; ++i)
+			pool.emplace_back(job, i);
+
+		if (count > 0)
+			job(0);
+
+		for (auto &t : pool)
+			t.join();
+	}
+
+	///
+	/// Persistent workers for ParallelInvoke()-like calls repeated every frame,
+	/// skipping the thread creation and heap allocations of each call.
+	///
+	class ThreadPool
+	{
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable wake, done;
+
+		// Ongoing call, type erased without allocating
+		void (*call)(void *, int) = NULL;
+		void *context = NULL;
+		int jobs = 0, pending = 0;
+		unsigned long generation = 0;
+		bool quit = false;
+
+		void Run(int index)
+		{
+			unsigned long seen = 0;
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while (true)
+			{
+				wake.wait(lock, [&] { return quit || generation != seen; });
+				if (quit)
+					return;
+				seen = generation;
+
+				if (index >= jobs)
+					continue;
+
+				lock.unlock();
+				call(context, index);
+				lock.lock();
+
+				if (--pending == 0)
+					done.notify_one();
+			}
+		}
+
+	  public:
+		ThreadPool(void) {}
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		~ThreadPool(void)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+			wake.notify_all();
+			for (auto &t : threads)
+				t.join();
+		}
+
+		/// <summary>
+		/// Make sure given amount of jobs can run at once, starting more threads if needed.
+		/// </summary>
+		/// <remarks>
+		/// Started threads are reported to the allocation hook.
+		/// </remarks>
+		void Reserve(int count)
+		{
+			AllocationHook hook = GetAllocationHook();
+			for (int i = (int)threads.size() + 1; i < count; ++i)
+			{
+				if (hook)
+					hook(sizeof(std::thread));
+				threads.emplace_back(&ThreadPool::Run, this, i);
+			}
+		}
+
+		/// <summary>
+		/// Same as ParallelInvoke(), on persistent threads. The calling thread takes the first job.
+		/// </summary>
+		/// <remarks>
+		/// Calls must not overlap nor nest.
+		/// </remarks>
+		template <typename F>
+		void Invoke(int count, F job)
+		{
+			if (count > 1)
+			{
+				Reserve(count);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					call = [](void *c, int i) { (*(F *)c)(i); };
+					context = &job;
+					jobs = count;
+					pending = count - 1;
+					++generation;
+				}
+				wake.notify_all();
+			}
+
+			if (count > 0)
+				job(0);
+
+			if (count > 1)
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				done.wait(lock, [this] { return pending == 0; });
+			}
+		}
+	};
+} // namespace Forth
@@ -1,15 +1,46 @@
 #pragma once
 #include "../math/Math.h"
+#include <cstring>
 
 namespace Forth
 {
+	///
+	/// Called with the byte size of every buffer allocation, NULL by default.
+	/// Handy to assert that steady-state frames never touch the heap.
+	/// Must be thread-safe when parallel slicing is used.
+	///
+	typedef void (*AllocationHook)(size_t bytes);
+
+	inline AllocationHook &GetAllocationHook(void)
+	{
+		static AllocationHook hook = NULL;
+		return hook;
+	}
+
+	inline void SetAllocationHook(AllocationHook hook)
+	{
+		GetAllocationHook() = hook;
+	}
+
+	///
+	/// Allocate an array, reporting it to the allocation hook.
+	///
+	template <typename T>
+	T *Allocate(const int count)
+	{
+		AllocationHook hook = GetAllocationHook();
+		if (hook)
+			hook(count * sizeof(T));
+		return new T[count];
+	}
+
 	template <typename T>
 	void EnsureCapacity(T **arr, const int count, int *cap, const int target)
 	{
 		if (*cap < target)
 		{
 			*cap = Max(target, *cap << 1);
-			T *newArr = new T[*cap];
+			T *newArr = Allocate<T>(*cap);
 
 			if (count > 0)
 			{
@@ -27,8 +58,8 @@ namespace Forth
 	b = c;
 
 #define FORTH_ARRAY(name, T) \
-	T *name = new T[4];      \
-	int name##_cap = 4;      \
+	T *name = Allocate<T>(4); \
+	int name##_cap = 4;       \
 	int name##_count = 0
 
 } // namespace Forth
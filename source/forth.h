@@ -9,15 +9,21 @@
 #include "common/Buffer3.h"
 #include "common/Buffer4.h"
 #include "common/BufferGL.h"
+#include "common/MeshFile.h"
+#include "common/StreamBuffer.h"
 #include "extras/MeshGen.h"
 #include "math/Transform4.h"
 #include "rendering/Frustum4.h"
 #include "rendering/CrossSection.h"
 #include "rendering/Model4.h"
+#include "rendering/RenderPipeline.h"
+#include "rendering/Scene4.h"
+#include "rendering/SceneBatch.h"
 #include "visualizer/SolidVisualizer.h"
 #include "visualizer/WireVisualizer.h"
 #include "visualizer/ParticleVisualizer.h"
 #include "visualizer/CustomVisualizer.h"
+#include "visualizer/GLVisualizer.h"
 
 #include "physics/broadphase/BroadPhase.h"
 #include "physics/broadphase/DynamicTree.h"
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "Transform4.h"
+
+// Pick the widest vector unit enabled by the compiler.
+// Define FORTH_NO_SIMD to force the scalar fallback.
+#if !defined(FORTH_NO_SIMD) && defined(__AVX__)
+#define FORTH_SIMD_AVX
+#include <immintrin.h>
+#elif !defined(FORTH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FORTH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Forth
+{
+	///
+	/// A lane holds LaneWidth floats processed together.
+	/// Comparisons return a bitmask, one bit per lane.
+	///
+
+#if defined(FORTH_SIMD_AVX)
+
+	typedef __m256 Lane;
+	const int LaneWidth = 8;
+
+	inline Lane LaneSet(float f) { return _mm256_set1_ps(f); }
+	inline Lane LaneLoad(const float *f) { return _mm256_loadu_ps(f); }
+	inline void LaneStore(float *f, Lane a) { _mm256_storeu_ps(f, a); }
+	inline Lane LaneAdd(Lane a, Lane b) { return _mm256_add_ps(a, b); }
+	inline Lane LaneSub(Lane a, Lane b) { return _mm256_sub_ps(a, b); }
+	inline Lane LaneMul(Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+	inline Lane LaneAbs(Lane a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+	inline int LaneLess(Lane a, Lane b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+	inline int LaneGreater(Lane a, Lane b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+
+#elif defined(FORTH_SIMD_SSE)
+
+	typedef __m128 Lane;
+	const int LaneWidth = 4;
+
+	inline Lane LaneSet(float f) { return _mm_set1_ps(f); }
+	inline Lane LaneLoad(const float *f) { return _mm_loadu_ps(f); }
+	inline void LaneStore(float *f, Lane a) { _mm_storeu_ps(f, a); }
+	inline Lane LaneAdd(Lane a, Lane b) { return _mm_add_ps(a, b); }
+	inline Lane LaneSub(Lane a, Lane b) { return _mm_sub_ps(a, b); }
+	inline Lane LaneMul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+	inline Lane LaneAbs(Lane a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+	inline int LaneLess(Lane a, Lane b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+	inline int LaneGreater(Lane a, Lane b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+
+#else
+
+	typedef float Lane;
+	const int LaneWidth = 1;
+
+	inline Lane LaneSet(float f) { return f; }
+	inline Lane LaneLoad(const float *f) { return *f; }
+	inline void LaneStore(float *f, Lane a) { *f = a; }
+	inline Lane LaneAdd(Lane a, Lane b) { return a + b; }
+	inline Lane LaneSub(Lane a, Lane b) { return a - b; }
+	inline Lane LaneMul(Lane a, Lane b) { return a * b; }
+	inline Lane LaneAbs(Lane a) { return Abs(a); }
+	inline int LaneLess(Lane a, Lane b) { return a < b ? 1 : 0; }
+	inline int LaneGreater(Lane a, Lane b) { return a > b ? 1 : 0; }
+
+#endif
+
+	///
+	/// LaneWidth vectors in structure-of-arrays form.
+	///
+	struct VectorLanes4
+	{
+		Lane x, y, z, w;
+	};
+
+	///
+	/// Load LaneWidth consecutive vectors, transposed into lanes.
+	///
+	inline VectorLanes4 LoadLanes(const Vector4 *v)
+	{
+		VectorLanes4 r;
+#if defined(FORTH_SIMD_AVX)
+		__m256 a = _mm256_loadu_ps(&v[0].x), b = _mm256_loadu_ps(&v[2].x),
+			   c = _mm256_loadu_ps(&v[4].x), d = _mm256_loadu_ps(&v[6].x);
+		// [v0|v4] [v1|v5] [v2|v6] [v3|v7], then transpose each 128-bit half
+		__m256 r0 = _mm256_permute2f128_ps(a, c, 0x20), r1 = _mm256_permute2f128_ps(a, c, 0x31),
+			   r2 = _mm256_permute2f128_ps(b, d, 0x20), r3 = _mm256_permute2f128_ps(b, d, 0x31);
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpacklo_ps(r2, r3),
+			   t2 = _mm256_unpackhi_ps(r0, r1), t3 = _mm256_unpackhi_ps(r2, r3);
+		r.x = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+		r.y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+		r.z = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		r.w = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+#elif defined(FORTH_SIMD_SSE)
+		r.x = _mm_loadu_ps(&v[0].x);
+		r.y = _mm_loadu_ps(&v[1].x);
+		r.z = _mm_loadu_ps(&v[2].x);
+		r.w = _mm_loadu_ps(&v[3].x);
+		_MM_TRANSPOSE4_PS(r.x, r.y, r.z, r.w);
+#else
+		r.x = v->x;
+		r.y = v->y;
+		r.z = v->z;
+		r.w = v->w;
+#endif
+		return r;
+	}
+
+	///
+	/// Store lanes back as LaneWidth consecutive vectors.
+	///
+	inline void StoreLanes(Vector4 *v, const VectorLanes4 &l)
+	{
+#if defined(FORTH_SIMD_AVX)
+		__m256 t0 = _mm256_unpacklo_ps(l.x, l.y), t1 = _mm256_unpacklo_ps(l.z, l.w),
+			   t2 = _mm256_unpackhi_ps(l.x, l.y), t3 = _mm256_unpackhi_ps(l.z, l.w);
+		__m256 r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)), r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)),
+			   r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)), r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		_mm256_storeu_ps(&v[0].x, _mm256_permute2f128_ps(r0, r1, 0x20));
+		_mm256_storeu_ps(&v[2].x, _mm256_permute2f128_ps(r2, r3, 0x20));
+		_mm256_storeu_ps(&v[4].x, _mm256_permute2f128_ps(r0, r1, 0x31));
+		_mm256_storeu_ps(&v[6].x, _mm256_permute2f128_ps(r2, r3, 0x31));
+#elif defined(FORTH_SIMD_SSE)
+		__m128 x = l.x, y = l.y, z = l.z, w = l.w;
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&v[0].x, x);
+		_mm_storeu_ps(&v[1].x, y);
+		_mm_storeu_ps(&v[2].x, z);
+		_mm_storeu_ps(&v[3].x, w);
+#else
+		v->Set(l.x, l.y, l.z, l.w);
+#endif
+	}
+
+	///
+	/// Load LaneWidth vectors starting at index i from structure-of-arrays storage.
+	///
+	inline VectorLanes4 LoadLanes(const float *const lanes[4], int i)
+	{
+		VectorLanes4 r;
+		r.x = LaneLoad(lanes[0] + i);
+		r.y = LaneLoad(lanes[1] + i);
+		r.z = LaneLoad(lanes[2] + i);
+		r.w = LaneLoad(lanes[3] + i);
+		return r;
+	}
+
+	///
+	/// Store LaneWidth vectors starting at index i into structure-of-arrays storage.
+	///
+	inline void StoreLanes(float *const lanes[4], int i, const VectorLanes4 &l)
+	{
+		LaneStore(lanes[0] + i, l.x);
+		LaneStore(lanes[1] + i, l.y);
+		LaneStore(lanes[2] + i, l.z);
+		LaneStore(lanes[3] + i, l.w);
+	}
+
+	///
+	/// Set the bits of lanes not in mask into bitset at index i (a multiple of LaneWidth).
+	/// LaneWidth divides 32, so a batch never straddles two words.
+	///
+	inline void StoreVisibleLanes(unsigned int *bitset, int i, int mask)
+	{
+		bitset[i / 32] |= (unsigned int)(~mask & ((1 << LaneWidth) - 1)) << (i % 32);
+	}
+
+	///
+	/// Transform4 with every element broadcasted into lanes.
+	///
+	struct TransformLanes4
+	{
+		Lane m[4][4], p[4];
+
+		TransformLanes4(const Transform4 &t)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int j = 0; j < 4; ++j)
+					m[i][j] = LaneSet(t.rotation[i][j]);
+				p[i] = LaneSet(t.position[i]);
+			}
+		}
+
+		/// <summary>
+		/// Transform a single row, same evaluation order as Transform4 * Vector4.
+		/// </summary>
+		inline Lane Row(int i, const VectorLanes4 &v) const
+		{
+			return LaneAdd(LaneAdd(LaneAdd(LaneAdd(LaneMul(m[i][0], v.x), LaneMul(m[i][1], v.y)),
+										   LaneMul(m[i][2], v.z)),
+								   LaneMul(m[i][3], v.w)),
+						   p[i]);
+		}
+
+		inline VectorLanes4 operator*(const VectorLanes4 &v) const
+		{
+			VectorLanes4 r;
+			r.x = Row(0, v);
+			r.y = Row(1, v);
+			r.z = Row(2, v);
+			r.w = Row(3, v);
+			return r;
+		}
+	};
+
+} // namespace Forth
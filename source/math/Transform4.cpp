@@ -1,6 +1,19 @@
 #include "Transform4.h"
+#include "Simd4.h"
 
 namespace Forth
 {
 	const Transform4 Transform4::identity = Transform4(Vector4(), Matrix4(1));
-}
\ No newline at end of file
+
+	void TransformBatch(const Transform4 &t, const Vector4 *src, Vector4 *dst, int count)
+	{
+		const TransformLanes4 m(t);
+		int i = 0;
+
+		for (; i + LaneWidth <= count; i += LaneWidth)
+			StoreLanes(dst + i, m * LoadLanes(src + i));
+
+		for (; i < count; ++i)
+			dst[i] = t * src[i];
+	}
+} // namespace Forth
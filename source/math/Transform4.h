@@ -147,6 +147,14 @@ namespace Forth
 		return Transpose(tx.rotation) * (v - tx.position);
 	}
 
+	/// <summary>
+	/// Transforms a batch of points, several at once when SIMD is available.
+	/// </summary>
+	/// <remarks>
+	/// Source and destination may be the same array.
+	/// </remarks>
+	void TransformBatch(const Transform4 &t, const Vector4 *src, Vector4 *dst, int count);
+
 	/// <summary>
 	/// Inverse the matrix
 	/// </summary>
@@ -1,5 +1,8 @@
-
 #include "CrossSection.h"
+#include "../math/Simd4.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
 
 namespace Forth
 {
@@ -8,44 +11,75 @@ namespace Forth
 	{
 	}
 
-	void CrossSection::InternalProject1(const Buffer4 &source, Visualizer4 *dest)
+	Visualizer4 *CrossSection::Worker::Get(SimplexMode mode)
+	{
+		switch (mode)
+		{
+		case SM_Point:
+			return &particle;
+		case SM_Line:
+			return &wire;
+		default:
+			return &solid;
+		}
+	}
+
+	template <class V>
+	void CrossSection::InternalProject1(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const
 	{
 		int *t4 = source.indices;
-		Vector4 *v4 = source.vertices;
-		// Loop over all point
-		for (int i = 0; i < source.indiceCount; i += 2)
+		Vector4 _temp[1];
+		// Loop over all crossing edges
+		for (int k = 0; k < count; k++)
 		{
-			// Do initial check if this edge is really intersect
-			if (sides[t4[i]] == sides[t4[i + 1]])
+			// Intersect
+			int i = crossing[k], a = t4[0 + i], b = t4[1 + i];
+
+			if (edges)
+			{
+				int id = CrossEdge(source, a, b, dest, *edges);
+				dest->RenderIndexed(&id, 1);
 				continue;
+			}
 
-			// Intersect
-			int a = t4[0 + i], b = t4[1 + i];
-			_temp[0] = CrossInterpolate(viewmodel * v4[a], viewmodel * v4[b]);
+			_temp[0] = CrossInterpolate(ViewVertex(source, a), ViewVertex(source, b));
 
 			// Push to destination
 			dest->Render(_temp, 1);
 		}
 	}
 
-	void CrossSection::InternalProject2(const Buffer4 &source, Visualizer4 *dest)
+	template <class V>
+	void CrossSection::InternalProject2(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const
 	{
 		int *t4 = source.indices;
-		Vector4 *v4 = source.vertices;
-		// Loop over all point
-		for (int i = 0; i < source.indiceCount; i += 3)
+		Vector4 _temp[3];
+		// Loop over all crossing triangles
+		for (int k = 0; k < count; k++)
 		{
-			// Do initial check if this edge is really intersect
-			if (IsEqual(sides[t4[i]], sides[t4[i + 1]], sides[t4[i + 2]]))
+			// Intersect
+			int i = crossing[k], iter = 0, a, b;
+
+			if (edges)
+			{
+				int ids[3];
+				for (int j = 0; j < 3; j++)
+				{
+					if (sides[a = t4[_leftEdges[j] + i]] ^ sides[b = t4[_rightEdges[j] + i]])
+					{
+						ids[iter++] = CrossEdge(source, a, b, dest, *edges);
+					}
+				}
+
+				dest->RenderIndexed(ids, iter);
 				continue;
+			}
 
-			// Intersect
-			int iter = 0, a, b;
 			for (int j = 0; j < 3; j++)
 			{
 				if (sides[a = t4[_leftEdges[j] + i]] ^ sides[b = t4[_rightEdges[j] + i]])
 				{
-					_temp[iter++] = CrossInterpolate(viewmodel * v4[a], viewmodel * v4[b]);
+					_temp[iter++] = CrossInterpolate(ViewVertex(source, a), ViewVertex(source, b));
 				}
 			}
 
@@ -54,60 +88,634 @@ namespace Forth
 		}
 	}
 
-	void CrossSection::InternalProject3(const Buffer4 &source, Visualizer4 *dest)
+	template <class V>
+	void CrossSection::InternalProject3(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const
 	{
 		int *t4 = source.indices;
+		Vector4 _temp[4];
 
-		// Loop over all point
-		for (int i = 0; i < source.indiceCount; i += 4)
+		// Loop over all crossing tetrahedrons
+		for (int k = 0; k < count; k++)
 		{
-			// Do initial check if this edge is really intersect
-			if (IsEqual(sides[t4[i]], sides[t4[i + 1]], sides[t4[i + 2]], sides[t4[i + 3]]))
+			// Intersect
+			int i = crossing[k], iter = 0, a, b;
+
+			if (edges)
+			{
+				int ids[4];
+				for (int j = 0; j < 6; j++)
+				{
+					if (sides[a = t4[_leftEdges[j] + i]] ^ sides[b = t4[_rightEdges[j] + i]])
+					{
+						if (orient)
+							_temp[iter] = CrossInterpolate(ViewVertex(source, Min(a, b)), ViewVertex(source, Max(a, b)));
+						ids[iter++] = CrossEdge(source, a, b, dest, *edges);
+					}
+				}
+
+				if (orient && IsFlipped(source, i, _temp, iter))
+					std::reverse(ids, ids + iter);
+
+				dest->RenderIndexed(ids, iter);
 				continue;
+			}
 
-			// Intersect
-			int iter = 0, a, b;
 			for (int j = 0; j < 6; j++)
 			{
 				if (sides[a = t4[_leftEdges[j] + i]] ^ sides[b = t4[_rightEdges[j] + i]])
 				{
-					_temp[iter++] = CrossInterpolate(vmverts[a], vmverts[b]);
+					_temp[iter++] = CrossInterpolate(ViewVertex(source, a), ViewVertex(source, b));
 				}
 			}
 
+			if (orient && IsFlipped(source, i, _temp, iter))
+				std::reverse(_temp, _temp + iter);
+
 			// Push to destination
 			dest->Render(_temp, iter);
 		}
 	}
-	void CrossSection::Project(const Buffer4 &source, const Transform4 &transform, Visualizer4 *dest)
+
+	bool CrossSection::IsFlipped(const Buffer4 &source, int i, const Vector4 *points, int count) const
+	{
+		const int *t = source.indices + i;
+		const Vector4 &a = ViewVertex(source, t[0]);
+		const Vector4 n = Cross(ViewVertex(source, t[1]) - a, ViewVertex(source, t[2]) - a, ViewVertex(source, t[3]) - a);
+
+		// Area weighted fan normal, same orientation as BufferGL::FillNormals()
+		Vector3 p = Vector3();
+		for (int j = 2; j < count; j++)
+		{
+			const Vector3 u = points[0].ToVec3(), v = points[j - 1].ToVec3(), w = points[j].ToVec3();
+			p = p + Cross(v - w, u - w);
+		}
+
+		// The slice lies in the hyperplane, so its normal is the projection of the 4D one
+		return Dot(p, n.ToVec3()) < 0;
+	}
+
+	template <class V>
+	int CrossSection::CrossEdge(const Buffer4 &source, int a, int b, V *dest, IntHashMap &edges) const
+	{
+		bool added;
+		int &id = edges.Get(IntHashMap::EdgeKey(a, b), -1, &added);
+
+		if (added)
+		{
+			// Always interpolate from the lower index so the result doesn't depend on winding
+			if (a > b)
+				std::swap(a, b);
+			id = dest->Emit(CrossInterpolate(ViewVertex(source, a), ViewVertex(source, b)));
+		}
+		return id;
+	}
+
+	template <class V>
+	void CrossSection::InternalProject(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const
+	{
+		switch (source.simplex)
+		{
+		case SimplexMode::SM_Line:
+			InternalProject1(source, dest, crossing, count, edges);
+			break;
+		case SimplexMode::SM_Triangle:
+			InternalProject2(source, dest, crossing, count, edges);
+			break;
+		case SimplexMode::SM_Tetrahedron:
+			InternalProject3(source, dest, crossing, count, edges);
+			break;
+		}
+	}
+
+	int CrossSection::InternalGather(const Buffer4 &source, int start, int end, int *crossing, int *points) const
+	{
+		const int *t4 = source.indices;
+		const int stride = source.simplex + 1;
+		int count = 0, total = 0;
+
+		for (int i = start; i < end; i += stride)
+		{
+			int s = 0;
+			for (int j = 0; j < stride; j++)
+				s += sides[t4[i + j]];
+
+			if (s == 0 || s == stride)
+				continue;
+
+			crossing[count++] = i;
+			// A tetrahedron split two by two gives a quad, otherwise one point less than its vertices
+			total += stride == 4 && s == 2 ? 4 : stride - 1;
+		}
+
+		*points = total;
+		return count;
+	}
+
+	int CrossSection::InternalGatherTree(const Buffer4 &source, int *crossing, int *points) const
+	{
+		const int *t4 = source.indices;
+		const int stride = source.simplex + 1;
+		const Vector4 normal = viewmodel.rotation.ew;
+		const float distance = viewmodel.position.w;
+		int count = 0, total = 0;
+
+		// Vertices outside visited leaves are never classified, shared ones just get classified again
+		source.tree->Query(normal, distance, [&](const int *simplices, int n) {
+			for (int k = 0; k < n; k++)
+			{
+				int i = simplices[k], s = 0;
+				for (int j = 0; j < stride; j++)
+				{
+					int v = t4[i + j];
+					s += sides[v] = Dot(normal, source.vertices[v]) + distance > 0.f;
+				}
+
+				if (s == 0 || s == stride)
+					continue;
+
+				crossing[count++] = i;
+				total += stride == 4 && s == 2 ? 4 : stride - 1;
+			}
+		});
+
+		*points = total;
+		return count;
+	}
+
+	int CrossSection::InternalGatherMarch(const Buffer4 &source, int *crossing, int *points) const
+	{
+		const int stride = source.simplex + 1;
+		const Vector4 normal = viewmodel.rotation.ew;
+		const float distance = viewmodel.position.w;
+		int count = 0, total = 0;
+
+		// Only vertices of visited simplices are classified, shared ones just get classified again
+		const auto side = [&](int v) { return sides[v] = Dot(normal, source.vertices[v]) + distance > 0.f; };
+
+		source.adjacency->March(source.indices, seeds.data(), (int)seeds.size(), side, [&](int i) {
+			int s = 0;
+			for (int j = 0; j < stride; j++)
+				s += sides[source.indices[i + j]];
+
+			crossing[count++] = i;
+			total += stride == 4 && s == 2 ? 4 : stride - 1;
+		});
+
+		*points = total;
+		return count;
+	}
+
+	int CrossSection::InternalGatherCache(const Buffer4 &source, const SliceCache &cache, int *crossing, int *points) const
+	{
+		const int *t4 = source.indices;
+		const int stride = source.simplex + 1;
+		const float shift = viewmodel.position.w, cut = -shift;
+		// Padded a bit so rounding never skips simplices touching the slice
+		const float pad = (Abs(shift) + cache.range) * 1e-5f + 1e-6f;
+		int count = 0, total = 0;
+
+		// No interval longer than span, so those starting far below the slice can't reach it
+		const int first = (int)(std::lower_bound(cache.lo.begin(), cache.lo.end(), cut - cache.span - pad) - cache.lo.begin());
+		const int last = (int)(std::upper_bound(cache.lo.begin(), cache.lo.end(), cut + pad) - cache.lo.begin());
+
+		for (int k = first; k < last; k++)
+		{
+			if (cache.hi[k] < cut - pad)
+				continue;
+
+			int i = cache.order[k], s = 0;
+			for (int j = 0; j < stride; j++)
+			{
+				int v = t4[i + j];
+				Vector4 &p = vmverts[v] = cache.rotated[v];
+				p.w += shift;
+				s += sides[v] = p.w > 0.f;
+			}
+
+			if (s == 0 || s == stride)
+				continue;
+
+			crossing[count++] = i;
+			total += stride == 4 && s == 2 ? 4 : stride - 1;
+		}
+
+		*points = total;
+		return count;
+	}
+
+	void CrossSection::BuildCache(const Buffer4 &source, SliceCache &cache) const
+	{
+		const int stride = source.simplex + 1;
+		const int count = source.indiceCount / stride;
+		const float shift = viewmodel.position.w;
+
+		cache.rotated.resize(source.verticeCount);
+		cache.range = 0;
+		for (int i = 0; i < source.verticeCount; i++)
+		{
+			Vector4 &p = cache.rotated[i] = viewmodel * source.vertices[i];
+			p.w -= shift;
+			cache.range = Max(cache.range, Abs(p.w));
+		}
+
+		std::vector<float> lo(count), hi(count);
+		cache.order.resize(count);
+		for (int s = 0; s < count; s++)
+		{
+			const int *t = source.indices + s * stride;
+			lo[s] = hi[s] = cache.rotated[t[0]].w;
+			for (int j = 1; j < stride; j++)
+			{
+				lo[s] = Min(lo[s], cache.rotated[t[j]].w);
+				hi[s] = Max(hi[s], cache.rotated[t[j]].w);
+			}
+			cache.order[s] = s;
+		}
+
+		std::sort(cache.order.begin(), cache.order.end(), [&](int a, int b) { return lo[a] < lo[b]; });
+
+		cache.lo.resize(count);
+		cache.hi.resize(count);
+		cache.span = 0;
+		for (int k = 0; k < count; k++)
+		{
+			const int s = cache.order[k];
+			cache.lo[k] = lo[s];
+			cache.hi[k] = hi[s];
+			cache.order[k] = s * stride;
+			cache.span = Max(cache.span, hi[s] - lo[s]);
+		}
+
+		cache.built = true;
+	}
+
+	SliceCache *CrossSection::UseCache(const Buffer4 &source, const Transform4 &transform, ProjectionCache **cache)
+	{
+		if (!cache)
+			return NULL;
+
+		SliceCache *c = dynamic_cast<SliceCache *>(*cache);
+		if (!c)
+		{
+			// Made by another projector
+			delete *cache;
+			*cache = c = new SliceCache();
+		}
+
+		viewmodel = view * transform;
+		const Transform4 key(Vector4(viewmodel.position.x, viewmodel.position.y, viewmodel.position.z, 0), viewmodel.rotation);
+
+		if (c->version != source.version || !(c->key == key))
+		{
+			c->key = key;
+			c->version = source.version;
+			c->built = false;
+			return NULL;
+		}
+
+		if (!c->built)
+			BuildCache(source, *c);
+		return c;
+	}
+
+	template <class V>
+	void CrossSection::InternalEmit(const Buffer4 &source, V *dest, const int *crossing, int count, int points, IntHashMap *edges) const
+	{
+		dest->Reserve(count, points);
+		// Every crossing edge is shared by at least two simplices in a closed mesh
+		if (edges)
+			edges->Reserve(edges->count + points / 2);
+
+		InternalProject(source, dest, crossing, count, edges);
+	}
+
+	template <class V>
+	void CrossSection::InternalSlice(const Buffer4 &source, V *dest, int start, int end, int **crossing, int *crossing_cap, IntHashMap *edges) const
+	{
+		// First pass counts, so output is allocated once before the second pass fills it
+		int points;
+		EnsureCapacity(crossing, 0, crossing_cap, (end - start) / (source.simplex + 1));
+		int count = InternalGather(source, start, end, *crossing, &points);
+
+		InternalEmit(source, dest, *crossing, count, points, edges);
+	}
+
+	void CrossSection::InternalTransform(const Buffer4 &source, int start, int end)
+	{
+		// Transform and classify LaneWidth vertices at once
+		const TransformLanes4 vm(viewmodel);
+		const Lane zero = LaneSet(0.f);
+		const bool soa = source.HasLanes();
+		int i = start;
+
+		for (; i + LaneWidth <= end; i += LaneWidth)
+		{
+			VectorLanes4 v = vm * (soa ? LoadLanes(source.lanes, i) : LoadLanes(source.vertices + i));
+			StoreLanes(vmverts + i, v);
+
+			int mask = LaneGreater(v.w, zero);
+			for (int j = 0; j < LaneWidth; ++j)
+				sides[i + j] = (mask >> j) & 1;
+		}
+
+		for (; i < end; ++i)
+		{
+			sides[i] = (vmverts[i] = viewmodel * source.vertices[i]).w > 0.f;
+		}
+	}
+
+	void CrossSection::InternalClassify(const Buffer4 &source, int start, int end)
+	{
+		// Only the W row matters to know which side a vertex is
+		const TransformLanes4 vm(viewmodel);
+		const Lane zero = LaneSet(0.f);
+		int i = start;
+
+		for (; i + LaneWidth <= end; i += LaneWidth)
+		{
+			int mask = LaneGreater(vm.Row(3, LoadLanes(source.lanes, i)), zero);
+			for (int j = 0; j < LaneWidth; ++j)
+				sides[i + j] = (mask >> j) & 1;
+		}
+
+		for (; i < end; ++i)
+		{
+			sides[i] = Dot(viewmodel.rotation.ew, source.vertices[i]) + viewmodel.position.w > 0.f;
+		}
+	}
+
+	void CrossSection::CullSpheres(const float *const centers[4], const float *radii, int count, unsigned int *visible) const
+	{
+		memset(visible, 0, ((count + 31) / 32) * sizeof(unsigned int));
+
+		const TransformLanes4 vm(view);
+		int i = 0;
+
+		for (; i + LaneWidth <= count; i += LaneWidth)
+		{
+			int culled = LaneGreater(LaneAbs(vm.Row(3, LoadLanes(centers, i))), LaneLoad(radii + i));
+			StoreVisibleLanes(visible, i, culled);
+		}
+
+		for (; i < count; i++)
+		{
+			SphereBounds4 bound(Vector4(centers[0][i], centers[1][i], centers[2][i], centers[3][i]), radii[i]);
+			if (!IsCullable(bound))
+				visible[i / 32] |= 1u << (i % 32);
+		}
+	}
+
+	void CrossSection::Prepare(const Buffer4 &source, const Transform4 &transform, bool eager)
 	{
 		viewmodel = view * transform;
 
 		EnsureCapacity(&sides, 0, &sides_cap, source.verticeCount);
 		EnsureCapacity(&vmverts, 0, &vmverts_cap, source.verticeCount);
+
+		lazy = !eager && (source.HasLanes() || source.tree || Marching(source));
+
+		if (lazy)
 		{
-			// faster than "sides[i] = (viewmodel * source.vertices[i]).w > 0"
-			/*const Vector4 &vmw = viewmodel.rotation.ew;
-			float vmwp = -viewmodel.position.w;*/
-			for (int i = 0; i < source.verticeCount; ++i)
+			if (stamps_cap < source.verticeCount)
 			{
-				sides[i] = (vmverts[i] = viewmodel * source.vertices[i]).w > 0.f/*(Dot(vmw, source.vertices[i])  > vmwp)*/;
+				EnsureCapacity(&stamps, 0, &stamps_cap, source.verticeCount);
+				memset(stamps, -1, stamps_cap * sizeof(int));
 			}
+			// Never hit -1, which marks fresh entries
+			stamp = stamp == INT_MAX ? 0 : stamp + 1;
 		}
+	}
 
+	template <class V>
+	void CrossSection::Project(const Buffer4 &source, const Transform4 &transform, V *dest)
+	{
+		Prepare(source, transform, slice != NULL);
+
+		IntHashMap *cache = NULL;
+		if (weld && dest->IsIndexed())
 		{
-			switch (source.simplex)
-			{
-			case SimplexMode::SM_Line:
-				InternalProject1(source, dest);
-				break;
-			case SimplexMode::SM_Triangle:
-				InternalProject2(source, dest);
-				break;
-			case SimplexMode::SM_Tetrahedron:
-				InternalProject3(source, dest);
-				break;
-			}
+			edges.Clear();
+			cache = &edges;
+		}
+
+		if (slice)
+		{
+			// Only simplices whose W interval reaches the slice are visited
+			int points;
+			EnsureCapacity(&crossing, 0, &crossing_cap, source.indiceCount / (source.simplex + 1));
+			int count = InternalGatherCache(source, *slice, crossing, &points);
+			InternalEmit(source, dest, crossing, count, points, cache);
+			return;
+		}
+
+		if (Marching(source))
+		{
+			// Only simplices connected to a seed through the slice are visited
+			int points;
+			source.adjacency->Update(source);
+			EnsureCapacity(&crossing, 0, &crossing_cap, source.indiceCount / (source.simplex + 1));
+			int count = InternalGatherMarch(source, crossing, &points);
+			InternalEmit(source, dest, crossing, count, points, cache);
+			return;
+		}
+
+		if (source.tree)
+		{
+			// Only leaves straddling the plane are visited, the rest of vertices is left untouched
+			int points;
+			source.tree->Update(source);
+			EnsureCapacity(&crossing, 0, &crossing_cap, source.indiceCount / (source.simplex + 1));
+			int count = InternalGatherTree(source, crossing, &points);
+			InternalEmit(source, dest, crossing, count, points, cache);
+			return;
+		}
+
+		if (lazy)
+			InternalClassify(source, 0, source.verticeCount);
+		else
+			InternalTransform(source, 0, source.verticeCount);
+
+		InternalSlice(source, dest, 0, source.indiceCount, &crossing, &crossing_cap, cache);
+	}
+
+	template void CrossSection::Project(const Buffer4 &, const Transform4 &, Visualizer4 *);
+	template void CrossSection::Project(const Buffer4 &, const Transform4 &, ParticleVisualizer *);
+	template void CrossSection::Project(const Buffer4 &, const Transform4 &, WireVisualizer *);
+	template void CrossSection::Project(const Buffer4 &, const Transform4 &, SolidVisualizer *);
+	template void CrossSection::Project(const Buffer4 &, const Transform4 &, GLVisualizer *);
+
+	void CrossSection::Project(const Buffer4 &source, const Transform4 &transform, Visualizer4 *dest)
+	{
+		Project<Visualizer4>(source, transform, dest);
+	}
+
+	template <class V>
+	void CrossSection::ProjectWith(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest, V *viz)
+	{
+		viz->Initialize(dest);
+		Project(source, transform, viz);
+		viz->End();
+	}
+
+	int CrossSection::ParallelCount(const Buffer4 &source) const
+	{
+		const int count = ThreadCount(threads);
+		const int simplices = source.indiceCount / (source.simplex + 1);
+
+		if (count > 1 && !source.tree && !slice && !Marching(source) && source.simplex != SM_Point && simplices >= parallelThreshold)
+			return Min(count, simplices);
+		return 1;
+	}
+
+	void CrossSection::Project(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest)
+	{
+		const int count = ParallelCount(source);
+
+		if (count > 1)
+		{
+			ParallelProject(source, transform, count);
+
+			dest.Clear();
+			dest.simplex = workers[0].output.simplex;
+			for (int t = 0; t < count; ++t)
+				dest.Append(workers[t].output);
+			return;
+		}
+
+		// Default visualizers are known, so skip the virtual calls
+		switch (SimplexModeForVisualizing(source.simplex))
+		{
+		case SM_Point:
+			ProjectWith(source, transform, dest, (ParticleVisualizer *)defaultVisualizers[SM_Point]);
+			break;
+		case SM_Line:
+			ProjectWith(source, transform, dest, (WireVisualizer *)defaultVisualizers[SM_Line]);
+			break;
+		case SM_Triangle:
+			ProjectWith(source, transform, dest, (SolidVisualizer *)defaultVisualizers[SM_Triangle]);
+			break;
+		default:
+			// Points have no cross section
+			dest.Clear();
+			break;
+		}
+	}
+
+	void CrossSection::Project(const Buffer4 &source, const Transform4 &transform, BufferGL &dest)
+	{
+		const int count = ParallelCount(source);
+		const SimplexMode mode = SimplexModeForVisualizing(source.simplex);
+
+		if (count > 1)
+		{
+			// Workers still slice into their own Buffer3, de-indexed (or rebased if indexed) here in one pass
+			ParallelProject(source, transform, count);
+
+			int vertices = 0;
+			for (int t = 0; t < count; ++t)
+				vertices += workers[t].output.indices_count;
+
+			dest.Setup(mode);
+			dest.Reserve(vertices);
+			for (int t = 0; t < count; ++t)
+				dest.Append(workers[t].output);
+			dest.Pack();
+			return;
+		}
+
+		if (source.simplex == SM_Point)
+		{
+			// Points have no cross section
+			dest.Setup(SM_Point);
+			return;
+		}
+
+		GLVisualizer viz;
+		viz.Initialize(dest, mode);
+		Project(source, transform, &viz);
+		viz.End();
+	}
+
+	void CrossSection::Project(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest, ProjectionCache **cache)
+	{
+		slice = UseCache(source, transform, cache);
+		Project(source, transform, dest);
+		slice = NULL;
+	}
+
+	void CrossSection::Project(const Buffer4 &source, const Transform4 &transform, BufferGL &dest, ProjectionCache **cache)
+	{
+		slice = UseCache(source, transform, cache);
+		Project(source, transform, dest);
+		slice = NULL;
+	}
+
+	void CrossSection::WorkerProject(const Buffer4 &source, Worker &w, SimplexMode mode, int start, int end) const
+	{
+		IntHashMap *cache = weld ? &w.edges : NULL;
+
+		switch (mode)
+		{
+		case SM_Point:
+			InternalSlice(source, &w.particle, start, end, &w.crossing, &w.crossing_cap, cache);
+			break;
+		case SM_Line:
+			InternalSlice(source, &w.wire, start, end, &w.crossing, &w.crossing_cap, cache);
+			break;
+		default:
+			InternalSlice(source, &w.solid, start, end, &w.crossing, &w.crossing_cap, cache);
+			break;
+		}
+	}
+
+	void CrossSection::ParallelProject(const Buffer4 &source, const Transform4 &transform, int count)
+	{
+		// Workers share vmverts, so it must be filled upfront
+		Prepare(source, transform, true);
+
+		if (workers_cap < count)
+		{
+			delete[] workers;
+			workers = Allocate<Worker>(workers_cap = count);
+		}
+
+		const int stride = source.simplex + 1;
+		const int simplices = source.indiceCount / stride;
+		const int vertices = source.verticeCount;
+		const SimplexMode mode = SimplexModeForVisualizing(source.simplex);
+
+		// Every worker transforms its own share of vertices first
+		pool.Invoke(count, [&](int t) {
+			InternalTransform(source, vertices * t / count, vertices * (t + 1) / count);
+		});
+
+		if (deterministic)
+		{
+			// One contiguous range per worker, merged back in order
+			pool.Invoke(count, [&](int t) {
+				Worker &w = workers[t];
+				Visualizer4 *viz = w.Get(mode);
+				viz->Initialize(w.output);
+				w.edges.Clear();
+				WorkerProject(source, w, mode, simplices * t / count * stride, simplices * (t + 1) / count * stride);
+				viz->End();
+			});
+		}
+		else
+		{
+			// Smaller chunks handed out on demand
+			const int chunks = Min(simplices, count * 8);
+			std::atomic<int> next(0);
+
+			pool.Invoke(count, [&](int t) {
+				Worker &w = workers[t];
+				Visualizer4 *viz = w.Get(mode);
+				viz->Initialize(w.output);
+				w.edges.Clear();
+				for (int c; (c = next++) < chunks;)
+					WorkerProject(source, w, mode, simplices * c / chunks * stride, simplices * (c + 1) / chunks * stride);
+				viz->End();
+			});
 		}
 	}
 } // namespace Forth
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../extras/HashMap.h"
+#include "../extras/Parallel.h"
 #include "../extras/Utils.h"
 #include "../math/Transform4.h"
 #include "Projector4.h"
@@ -7,6 +9,34 @@
 
 namespace Forth
 {
+	/// <summary>
+	/// Per-model vertices transformed by the view without its W offset,
+	/// and simplices sorted by their W interval.
+	/// </summary>
+	/// <remarks>
+	/// Reused while only the view W offset changes, then only simplices around the slice are visited.
+	/// </remarks>
+	struct SliceCache : public ProjectionCache
+	{
+		/// Viewmodel this cache matches, W offset excluded
+		Transform4 key;
+
+		/// Buffer4::version this cache matches
+		unsigned long version = ULONG_MAX;
+
+		/// Whether below has been filled for key and version
+		bool built = false;
+
+		std::vector<Vector4> rotated;
+
+		/// Simplex starts, with their W interval, sorted by its lower end
+		std::vector<int> order;
+		std::vector<float> lo, hi;
+
+		/// Longest interval, and largest absolute W
+		float span = 0, range = 0;
+	};
+
 	class CrossSection : public Projector4
 	{
 
@@ -14,19 +44,194 @@ namespace Forth
 		int sides_cap = 4;
 		Vector4 *vmverts = new Vector4[4];
 		int vmverts_cap = 4;
-		Vector4 _temp[4];
 
-		// Internal separate projection methods
-		void InternalProject1(const Buffer4 &source, Visualizer4 *dest);
-		void InternalProject2(const Buffer4 &source, Visualizer4 *dest);
-		void InternalProject3(const Buffer4 &source, Visualizer4 *dest);
+		// When source has lanes, only W is transformed upfront.
+		// The rest of vmverts is filled on demand, tracked by stamps.
+		int *stamps = new int[4];
+		int stamps_cap = 4;
+		int stamp = 0;
+		bool lazy = false;
+
+		// Start of every simplex crossing the slicing plane, gathered before slicing
+		int *crossing = new int[4];
+		int crossing_cap = 4;
+
+		/// <summary>
+		/// Per-thread slicing output, merged after all workers are done.
+		/// </summary>
+		struct Worker
+		{
+			Buffer3 output;
+			ParticleVisualizer particle;
+			WireVisualizer wire;
+			SolidVisualizer solid;
+			IntHashMap edges;
+			int *crossing = NULL;
+			int crossing_cap = 0;
+
+			~Worker(void) { delete[] crossing; }
+
+			Visualizer4 *Get(SimplexMode mode);
+		};
+
+		Worker *workers = NULL;
+		int workers_cap = 0;
+
+		// Threads running the workers, kept across projections
+		ThreadPool pool;
+
+		// Crossing edge to output vertex index, used when welding
+		IntHashMap edges;
+
+		// Internal separate projection methods, operating on gathered crossing simplices.
+		// Output is welded through given edge cache if not NULL.
+		template <class V>
+		void InternalProject1(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const;
+		template <class V>
+		void InternalProject2(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const;
+		template <class V>
+		void InternalProject3(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const;
+		template <class V>
+		void InternalProject(const Buffer4 &source, V *dest, const int *crossing, int count, IntHashMap *edges) const;
+
+		// Gather simplices in indices [start, end) crossing the plane, with their total slice points
+		int InternalGather(const Buffer4 &source, int start, int end, int *crossing, int *points) const;
+
+		// Gather crossing simplices from leaves of source's tree, classifying only their vertices
+		int InternalGatherTree(const Buffer4 &source, int *crossing, int *points) const;
+
+		// Gather crossing simplices by marching source's adjacency from seeds, classifying only their vertices
+		int InternalGatherMarch(const Buffer4 &source, int *crossing, int *points) const;
+
+		// Gather crossing simplices around the slice from sorted intervals, filling their sides and vmverts
+		int InternalGatherCache(const Buffer4 &source, const SliceCache &cache, int *crossing, int *points) const;
+
+		// Transform vertices and sort simplex intervals into cache
+		void BuildCache(const Buffer4 &source, SliceCache &cache) const;
+
+		// Return the cache to slice from if valid for current viewmodel, NULL otherwise.
+		// Built only once the same viewmodel (but W offset) is seen twice in a row.
+		SliceCache *UseCache(const Buffer4 &source, const Transform4 &transform, ProjectionCache **cache);
+
+		// Cache used by the ongoing projection, if any
+		SliceCache *slice = NULL;
+
+		// Reserve the exact output, then slice gathered simplices
+		template <class V>
+		void InternalEmit(const Buffer4 &source, V *dest, const int *crossing, int count, int points, IntHashMap *edges) const;
+
+		// Gather, reserve the exact output, then slice indices [start, end)
+		template <class V>
+		void InternalSlice(const Buffer4 &source, V *dest, int start, int end, int **crossing, int *crossing_cap, IntHashMap *edges) const;
+
+		// Does the polygon sliced from the tetrahedron at i face against the tetrahedron's 4D normal?
+		bool IsFlipped(const Buffer4 &source, int i, const Vector4 *points, int count) const;
+
+		// Interpolate crossing edge once, return the emitted vertex index
+		template <class V>
+		int CrossEdge(const Buffer4 &source, int a, int b, V *dest, IntHashMap &edges) const;
+
+		// Slice [start, end) into a worker's own visualizer
+		void WorkerProject(const Buffer4 &source, Worker &w, SimplexMode mode, int start, int end) const;
+
+		// Run a whole projection into Buffer3 through a known visualizer
+		template <class V>
+		void ProjectWith(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest, V *viz);
+
+		// Transform source vertices [start, end) and classify their sides
+		void InternalTransform(const Buffer4 &source, int start, int end);
+
+		// Classify source vertices [start, end) from W lane only
+		void InternalClassify(const Buffer4 &source, int start, int end);
+
+		// Prepare sides and vmverts for given source.
+		// Unless eager, vmverts is filled on demand when source has lanes or a tree.
+		void Prepare(const Buffer4 &source, const Transform4 &transform, bool eager);
+
+		inline const Vector4 &ViewVertex(const Buffer4 &source, int i) const
+		{
+			if (lazy && stamps[i] != stamp)
+			{
+				vmverts[i] = viewmodel * source.vertices[i];
+				stamps[i] = stamp;
+			}
+			return vmverts[i];
+		}
+
+		// Whether given source is gathered by InternalGatherMarch()
+		bool Marching(const Buffer4 &source) const { return source.adjacency && !seeds.empty(); }
+
+		// Amount of workers to slice given source with, one if not worth going parallel
+		int ParallelCount(const Buffer4 &source) const;
+
+		// Slice into every worker's own output
+		void ParallelProject(const Buffer4 &source, const Transform4 &transform, int count);
 
 	  public:
+		/// <summary>
+		/// Worker threads used when projecting into Buffer3.
+		/// One (the default) keeps slicing on the calling thread, zero or less uses all hardware threads.
+		/// Threads are started on first use and kept until the projector is destroyed.
+		/// </summary>
+		int threads = 1;
+
+		/// <summary>
+		/// Keep parallel output in the exact same order as the single-threaded one.
+		/// </summary>
+		/// <remarks>
+		/// When disabled, workers pull smaller chunks on demand which balances better
+		/// but the order of polygons in the output differs between frames.
+		/// </remarks>
+		bool deterministic = true;
+
+		/// <summary>
+		/// Interpolate each crossing edge once and share the resulting vertex
+		/// between neighbouring simplices, producing an indexed (welded) output.
+		/// </summary>
+		/// <remarks>
+		/// Only applies to visualizers that support indexed rendering.
+		/// Parallel workers weld independently, so edges on chunk borders are duplicated.
+		/// </remarks>
+		bool weld = false;
+
+		/// <summary>
+		/// Wind every polygon sliced from a tetrahedron after its 4D orientation,
+		/// so the slice of a consistently wound volume faces consistently (e.g. outwards).
+		/// </summary>
+		/// <remarks>
+		/// Replaces SolidVisualizer::RefineTriangleOrder(), at the cost of one 4D cross product per crossing tetrahedron.
+		/// </remarks>
+		bool orient = false;
+
+		/// <summary>
+		/// Minimum simplex count before slicing is split across threads.
+		/// </summary>
+		/// <remarks>
+		/// Sources with a simplex tree (see Buffer4::SetTree()), marched from seeds or with a valid SliceCache
+		/// are always sliced on the calling thread.
+		/// </remarks>
+		int parallelThreshold = 4096;
+
+		/// <summary>
+		/// Simplex starts (offsets in Buffer4::indices) to march the slice from,
+		/// when the source has an adjacency table (see Buffer4::SetAdjacency()).
+		/// </summary>
+		/// <remarks>
+		/// Only simplices reached from a crossing seed through crossing neighbours are sliced,
+		/// so give at least one seed per separate piece of the slice (e.g. crossing simplices of the last frame).
+		/// Takes over the simplex tree, but not a valid SliceCache. Left empty, sources are gathered as usual.
+		/// </remarks>
+		std::vector<int> seeds;
+
 		CrossSection(void);
 
 		~CrossSection(void)
 		{
 			delete[] sides;
+			delete[] vmverts;
+			delete[] stamps;
+			delete[] crossing;
+			delete[] workers;
 		}
 
 		/// <summary>
@@ -34,6 +239,36 @@ namespace Forth
 		/// </summary>
 		void Project(const Buffer4 &source, const Transform4 &transform, Visualizer4 *dest) override;
 
+		/// <summary>
+		/// Projection into a known visualizer type, letting per-simplex calls inline.
+		/// </summary>
+		/// <remarks>
+		/// Instantiated for the built-in visualizers and Visualizer4,
+		/// the latter being the same as the virtual overload.
+		/// </remarks>
+		template <class V>
+		void Project(const Buffer4 &source, const Transform4 &transform, V *dest);
+
+		/// <summary>
+		/// Projection straight into GPU layout, skipping Buffer3
+		/// </summary>
+		void Project(const Buffer4 &source, const Transform4 &transform, BufferGL &dest) override;
+
+		/// <summary>
+		/// Dynamic projection with default visualizer, sliced in parallel if enabled
+		/// </summary>
+		void Project(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest) override;
+
+		/// <summary>
+		/// Projection with default visualizer, fast when only the view W offset changed since last call.
+		/// </summary>
+		void Project(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest, ProjectionCache **cache) override;
+
+		/// <summary>
+		/// Projection straight into GPU layout, fast when only the view W offset changed since last call.
+		/// </summary>
+		void Project(const Buffer4 &source, const Transform4 &transform, BufferGL &dest, ProjectionCache **cache) override;
+
 		/// <summary>
 		/// Arbitrary (4D to 3D) point projection
 		/// </summary>
@@ -57,9 +292,15 @@ namespace Forth
 		bool IsCullable(const SphereBounds4 &bound) const override
 		{
 			// IsIntersecting(slicer, bound); <- Unoptimized
-			return Abs(bound.center.w + view.position.w) > bound.radius;
+			// Distance to the slice is the W of the center in view space
+			return Abs(Dot(view.rotation.ew, bound.center) + view.position.w) > bound.radius;
 		}
 
+		/// <summary>
+		/// Same test as IsCullable(), LaneWidth spheres at once
+		/// </summary>
+		void CullSpheres(const float *const centers[4], const float *radii, int count, unsigned int *visible) const override;
+
 		/// <summary>
 		/// Adapt to simplex requirement for this projection.
 		/// </summary>
@@ -1,4 +1,7 @@
 #include "Frustum4.h"
+#include "../math/Simd4.h"
+#include <algorithm>
+#include <cassert>
 
 namespace Forth
 {
@@ -34,20 +37,21 @@ namespace Forth
 
 		if (useFrustumCulling)
 		{
+			// Behind the eye rN > rP, so both planes of an axis may be crossed
 			if (vertex.x < rN)
 				interpol = Max(interpol, xMinPlane.Intersect(vertex, other));
-			else if (vertex.x > rP)
+			if (vertex.x > rP)
 				interpol = Max(interpol, xMaxPlane.Intersect(vertex, other));
 
 			if (vertex.y < rN)
 				interpol = Max(interpol, yMinPlane.Intersect(vertex, other));
-			else if (vertex.y > rP)
+			if (vertex.y > rP)
 				interpol = Max(interpol, yMaxPlane.Intersect(vertex, other));
 
 			if (vertex.z < rN)
 				interpol = Max(interpol, zMinPlane.Intersect(vertex, other));
-			else if (vertex.z > rP)
-				interpol = Max(interpol, farPlane.Intersect(vertex, other));
+			if (vertex.z > rP)
+				interpol = Max(interpol, zMaxPlane.Intersect(vertex, other));
 		}
 
 		return LerpUnclamped(vertex, other, interpol);
@@ -148,17 +152,17 @@ namespace Forth
 		{
 			if ((flag & 0x1) > 0)
 				interpol = Max(interpol, xMinPlane.Intersect(vertex, other));
-			else if ((flag & 0x2) > 0)
+			if ((flag & 0x2) > 0)
 				interpol = Max(interpol, xMaxPlane.Intersect(vertex, other));
 
 			if ((flag & 0x4) > 0)
 				interpol = Max(interpol, yMinPlane.Intersect(vertex, other));
-			else if ((flag & 0x8) > 0)
+			if ((flag & 0x8) > 0)
 				interpol = Max(interpol, yMaxPlane.Intersect(vertex, other));
 
 			if ((flag & 0x10) > 0)
 				interpol = Max(interpol, zMinPlane.Intersect(vertex, other));
-			else if ((flag & 0x20) > 0)
+			if ((flag & 0x20) > 0)
 				interpol = Max(interpol, zMaxPlane.Intersect(vertex, other));
 		}
 
@@ -170,7 +174,7 @@ namespace Forth
 		return LerpUnclamped(vertex, other, interpol);
 	}
 
-	int Frustum4::GetSide(const Vector4 &v)
+	int Frustum4::GetSide(const Vector4 &v) const
 	{
 		int flag = 0;
 		float rP = ratio * v.w, rN = -rP;
@@ -182,19 +186,20 @@ namespace Forth
 
 		if (useFrustumCulling)
 		{
+			// Behind the eye rN > rP, so a vertex can be outside of both planes of an axis
 			if (v.x < rN)
 				flag |= 0x1;
-			else if (v.x > rP)
+			if (v.x > rP)
 				flag |= 0x2;
 
 			if (v.y < rN)
 				flag |= 0x4;
-			else if (v.y > rP)
+			if (v.y > rP)
 				flag |= 0x8;
 
 			if (v.z < rN)
 				flag |= 0x10;
-			else if (v.z > rP)
+			if (v.z > rP)
 				flag |= 0x20;
 		}
 
@@ -220,7 +225,214 @@ namespace Forth
 		return true; // Definitely inside
 	}
 
-	void Frustum4::InternalProject1(const Buffer4 &source, Visualizer4 *dest)
+	float Frustum4::GetDistance(int plane, const Vector4 &v) const
+	{
+		const float r = ratio * v.w;
+
+		switch (plane)
+		{
+		case 0:
+			return -v.x - r;
+		case 1:
+			return v.x - r;
+		case 2:
+			return -v.y - r;
+		case 3:
+			return v.y - r;
+		case 4:
+			return -v.z - r;
+		case 5:
+			return v.z - r;
+		case 6:
+			return nearClip - v.w;
+		default:
+			return v.w - farClip;
+		}
+	}
+
+	int Frustum4::ClipPolygon(int plane, const Vector4 input[], int length, Vector4 result[], int capacity, int *caps)
+	{
+		int count = 0;
+
+		// Cap points are shared between faces, add each once
+		auto addCap = [&](const Vector4 &p) {
+			for (int k = 0; k < *caps; k++)
+				if (_cap[k].x == p.x && _cap[k].y == p.y && _cap[k].z == p.z && _cap[k].w == p.w)
+					return;
+			assert(*caps < (int)(sizeof(_cap) / sizeof(*_cap)));
+			_cap[(*caps)++] = p;
+		};
+
+		for (int i = 0; i < length; ++i)
+		{
+			const Vector4 &a = input[i], &b = input[(i + 1) % length];
+			float da = GetDistance(plane, a), db = GetDistance(plane, b);
+
+			// Convex input gains at most one point per plane, but the caller's storage is what matters
+			assert(count + 2 <= capacity);
+
+			if (da <= 0)
+			{
+				result[count++] = a;
+				if (da == 0 && caps)
+					addCap(a);
+			}
+
+			if ((da < 0 && db > 0) || (da > 0 && db < 0))
+			{
+				// Always interpolate from the inside point, so neighbouring faces get the exact same result
+				Vector4 cv = da < 0 ? a + (b - a) * (da / (da - db)) : b + (a - b) * (db / (db - da));
+				result[count++] = cv;
+				if (caps)
+					addCap(cv);
+			}
+		}
+		return count;
+	}
+
+	int Frustum4::ClipTetrahedron(const Vector4 &a, const Vector4 &b, const Vector4 &c, const Vector4 &d, int planes)
+	{
+		const Vector4 v[4] = {a, b, c, d};
+		int faces = 4;
+
+		for (int f = 0; f < 4; f++)
+		{
+			// Every face is the tetrahedron without one of its vertices
+			for (int j = 0, k = 0; j < 4; j++)
+				if (j != f)
+					_faces[f][k++] = v[j];
+			_faceCounts[f] = 3;
+		}
+
+		for (int plane = 0; plane < 8; plane++)
+		{
+			if (!(planes & (1 << plane)))
+				continue;
+
+			int caps = 0, kept = 0;
+			Vector4 clipped[16];
+
+			for (int f = 0; f < faces; f++)
+			{
+				int count = ClipPolygon(plane, _faces[f], _faceCounts[f], clipped, (int)(sizeof(clipped) / sizeof(*clipped)), &caps);
+				if (count < 3)
+					continue;
+
+				memcpy(_faces[kept], clipped, count * sizeof(Vector4));
+				_faceCounts[kept++] = count;
+			}
+
+			if (caps >= 3)
+			{
+				// Cap is convex, so order its points by angle around the center
+				Vector4 center = Vector4(), u = Vector4(), w = Vector4();
+				float angles[16], best = 0;
+
+				for (int k = 0; k < caps; k++)
+					center += _cap[k];
+				center /= (float)caps;
+
+				u = _cap[0] - center;
+				for (int k = 1; k < caps; k++)
+				{
+					Vector4 e = _cap[k] - center;
+					e -= u * (Dot(e, u) / Dot(u, u));
+					if (LengthSq(e) > best)
+						best = LengthSq(w = e);
+				}
+
+				for (int k = 0; k < caps; k++)
+					angles[k] = atan2(Dot(_cap[k] - center, w), Dot(_cap[k] - center, u));
+
+				for (int k = 1; k < caps; k++)
+				{
+					for (int j = k; j > 0 && angles[j - 1] > angles[j]; j--)
+					{
+						std::swap(angles[j - 1], angles[j]);
+						std::swap(_cap[j - 1], _cap[j]);
+					}
+				}
+
+				assert(kept < (int)(sizeof(_faceCounts) / sizeof(*_faceCounts)));
+				memcpy(_faces[kept], _cap, caps * sizeof(Vector4));
+				_faceCounts[kept++] = caps;
+			}
+
+			if ((faces = kept) == 0)
+				break;
+		}
+
+		if (faces == 0)
+			return 0;
+
+		// Wind every face after the tetrahedron, the polytope center being inside of it
+		const Vector4 normal = Cross(b - a, c - a, d - a);
+		Vector4 center = Vector4();
+		int points = 0;
+
+		for (int f = 0; f < faces; f++)
+		{
+			for (int j = 0; j < _faceCounts[f]; j++)
+				center += _faces[f][j];
+			points += _faceCounts[f];
+		}
+		center /= (float)points;
+
+		for (int f = 0; f < faces; f++)
+		{
+			if (IsFlipped(_faces[f], _faceCounts[f], normal, center))
+				std::reverse(_faces[f], _faces[f] + _faceCounts[f]);
+		}
+
+		return faces;
+	}
+
+	bool Frustum4::IsFlipped(const Vector4 *points, int count, const Vector4 &normal, const Vector4 &inner)
+	{
+		// Area weighted fan normal, kept inside the tetrahedron hyperplane by the 4D cross product
+		Vector4 p = Vector4();
+		for (int j = 2; j < count; j++)
+			p += Cross(points[j - 1] - points[0], points[j] - points[0], normal);
+
+		return Dot(p, points[0] - inner) < 0;
+	}
+
+	void Frustum4::InternalCount(const Buffer4 &source, int *polygons, int *points) const
+	{
+		const int *t4 = source.indices;
+		const int stride = source.simplex + 1;
+		int inside = 0, intersect = 0;
+
+		for (int i = 0; i < source.indiceCount; i += stride)
+		{
+			int any = 0, all = 0xFF;
+			for (int j = 0; j < stride; j++)
+			{
+				any |= sides[t4[i + j]];
+				all &= sides[t4[i + j]];
+			}
+
+			if (any == 0)
+				inside++;
+			else if (all == 0)
+				intersect++;
+		}
+
+		if (stride == 4)
+		{
+			// Tetrahedrons are drawn by their faces, a clipped one is only guessed as its faces plus a cap
+			*polygons = inside * 4 + intersect * 5;
+			*points = inside * 12 + intersect * (12 + 8);
+			return;
+		}
+
+		// A clipped triangle gains at most one vertex per frustum plane
+		*polygons = inside + intersect;
+		*points = inside * stride + intersect * (stride == 3 ? 3 + 8 : stride);
+	}
+
+	template <class V>
+	void Frustum4::InternalProject1(const Buffer4 &source, V *dest)
 	{
 		int *t4 = source.indices;
 		auto t4c = source.indiceCount;
@@ -230,7 +442,7 @@ namespace Forth
 		for (int i = 0; i < t4c; i += 1)
 		{
 			// Get the case
-			switch (GetCase(s[t4[i + 0]]))
+			switch (GetCase(!s[t4[i + 0]]))
 			{
 			case FRC_Inside:
 				// Add 'em all & Push
@@ -241,7 +453,8 @@ namespace Forth
 		}
 	}
 
-	void Frustum4::InternalProject2(const Buffer4 &source, Visualizer4 *dest)
+	template <class V>
+	void Frustum4::InternalProject2(const Buffer4 &source, V *dest)
 	{
 		int *t4 = source.indices;
 		auto t4c = source.indiceCount;
@@ -252,7 +465,7 @@ namespace Forth
 		{
 			// Get the case
 			int a, b;
-			switch (GetCase(s[a = t4[i + 0]], s[b = t4[i + 1]]))
+			switch (GetCase(!s[a = t4[i + 0]], !s[b = t4[i + 1]]))
 			{
 			case FRC_Inside:
 				// Add 'em all & Push
@@ -261,7 +474,7 @@ namespace Forth
 				dest->Render(t, 2);
 				break;
 			case FRC_Intersect:
-				if (s[a])
+				if (!s[a])
 				{
 					t[0] = ProjectPoint(vmverts[a]);
 					t[1] = ProjectPoint(Clip(vmverts[b], vmverts[a]));
@@ -277,7 +490,8 @@ namespace Forth
 		}
 	}
 
-	void Frustum4::InternalProject3(const Buffer4 &source, Visualizer4 *dest)
+	template <class V>
+	void Frustum4::InternalProject3(const Buffer4 &source, V *dest)
 	{
 		int *t4 = source.indices;
 		auto t4c = source.indiceCount;
@@ -287,35 +501,93 @@ namespace Forth
 		// Loop over all triangle
 		for (int i = 0; i < t4c; i += 3)
 		{
-			// Get the case
-			int a, b, c;
-			switch (GetCase(s[a = t4[i + 0]], s[b = t4[i + 1]], s[c = t4[i + 2]]))
+			int a = t4[i + 0], b = t4[i + 1], c = t4[i + 2];
+			int any = s[a] | s[b] | s[c];
+
+			if (any == 0)
 			{
-			case FRC_Inside:
 				// Add 'em all & Push
 				t[0] = ProjectPoint(vmverts[a]);
 				t[1] = ProjectPoint(vmverts[b]);
 				t[2] = ProjectPoint(vmverts[c]);
 				dest->Render(t, 3);
-				break;
-			case FRC_Intersect:
-				t[0] = (vmverts[a]);
-				t[1] = (vmverts[b]);
-				t[2] = (vmverts[c]);
+				continue;
+			}
 
-				// Special algorithm
-				int count = OrthographicW(_temp, 3, _temp2);
-				if (useFrustumCulling)
+			// All outside of the same plane
+			if (s[a] & s[b] & s[c])
+				continue;
+
+			// Clip only with planes that some vertex is outside of
+			Vector4 *in = _temp, *out = _temp2;
+			int count = 3;
+			in[0] = vmverts[a];
+			in[1] = vmverts[b];
+			in[2] = vmverts[c];
+
+			for (int plane = 0; plane < 8 && count >= 3; plane++)
+			{
+				if (any & (1 << plane))
 				{
-					count = OrthographicXYZ(0, _temp, count, _temp2);
-					count = OrthographicXYZ(1, _temp2, count, _temp);
-					count = OrthographicXYZ(2, _temp, count, _temp2);
+					count = ClipPolygon(plane, in, count, out, (int)(sizeof(_temp) / sizeof(*_temp)));
+					std::swap(in, out);
 				}
+			}
 
-				for (int j = 0; j < count; j++)
-					_temp2[j] = ProjectPoint(_temp2[j]);
-				dest->Render(_temp2, count);
-				break;
+			if (count < 3)
+				continue;
+
+			for (int j = 0; j < count; j++)
+				in[j] = ProjectPoint(in[j]);
+			dest->Render(in, count);
+		}
+	}
+
+	template <class V>
+	void Frustum4::InternalProject4(const Buffer4 &source, V *dest)
+	{
+		int *t4 = source.indices;
+		auto t4c = source.indiceCount;
+		auto s = sides;
+		auto t = _temp;
+
+		// Loop over all tetrahedron
+		for (int i = 0; i < t4c; i += 4)
+		{
+			int a = t4[i + 0], b = t4[i + 1], c = t4[i + 2], d = t4[i + 3];
+
+			if ((s[a] | s[b] | s[c] | s[d]) == 0)
+			{
+				// Faces without vertex f alternate their orientation with f, so test only the first one
+				t[0] = vmverts[b];
+				t[1] = vmverts[c];
+				t[2] = vmverts[d];
+				const bool flipped = IsFlipped(t, 3, Cross(t[0] - vmverts[a], t[1] - vmverts[a], t[2] - vmverts[a]), vmverts[a]);
+
+				// Add every face & Push
+				for (int f = 0; f < 4; f++)
+				{
+					for (int j = 0, k = 0; j < 4; j++)
+						if (j != f)
+							t[k++] = ProjectPoint(vmverts[t4[i + j]]);
+					if (flipped ^ (f & 1))
+						std::swap(t[1], t[2]);
+					dest->Render(t, 3);
+				}
+				continue;
+			}
+
+			// Vertices outside of the frustum may still have the tetrahedron crossing it,
+			// unless all of them are outside of the same plane
+			if (s[a] & s[b] & s[c] & s[d])
+				continue;
+
+			int faces = ClipTetrahedron(vmverts[a], vmverts[b], vmverts[c], vmverts[d], s[a] | s[b] | s[c] | s[d]);
+			for (int f = 0; f < faces; f++)
+			{
+				for (int j = 0; j < _faceCounts[f]; j++)
+					_faces[f][j] = ProjectPoint(_faces[f][j]);
+				dest->Render(_faces[f], _faceCounts[f]);
 			}
 		}
 	}
@@ -323,29 +595,64 @@ namespace Forth
 	bool Frustum4::IsSphereInFrustum(const SphereBounds4 &bound) const
 	{
 		auto radius = bound.radius;
+		auto xyz = view * (bound.center);
+
+		if (xyz.w + radius < nearClip || xyz.w - radius > farClip)
+			return false;
+
 		if (useFrustumCulling)
 		{
-			auto xyz = view * (bound.center);
+			// Side planes are |axis| = ratio * w, their normals are 1 / sqrt(ratio^2 + 1) long
 			auto ratio = this->ratio * xyz.w;
+			radius *= Sqrt(this->ratio * this->ratio + 1);
 
-			if (xyz.w + radius < nearClip || xyz.w - radius > farClip)
-				return false;
 			if (xyz.x + radius < -ratio || xyz.x - radius > ratio)
 				return false;
 			if (xyz.y + radius < -ratio || xyz.y - radius > ratio)
 				return false;
 			if (xyz.z + radius < -ratio || xyz.z - radius > ratio)
 				return false;
-			return true;
 		}
-		else
+		return true;
+	}
+
+	void Frustum4::CullSpheres(const float *const centers[4], const float *radii, int count, unsigned int *visible) const
+	{
+		memset(visible, 0, ((count + 31) / 32) * sizeof(unsigned int));
+
+		const TransformLanes4 vm(view);
+		const Lane nearW = LaneSet(nearClip), farW = LaneSet(farClip), r = LaneSet(ratio), zero = LaneSet(0.f),
+				   scale = LaneSet(Sqrt(ratio * ratio + 1));
+		int i = 0;
+
+		for (; i + LaneWidth <= count; i += LaneWidth)
 		{
-			float n = Dot(view * Vector4(3, 1.f), bound.center + view.position);
-			return (n + radius >= nearClip && n - radius < farClip);
+			VectorLanes4 c = vm * LoadLanes(centers, i);
+			Lane radius = LaneLoad(radii + i);
+
+			int outside = LaneLess(LaneAdd(c.w, radius), nearW) | LaneGreater(LaneSub(c.w, radius), farW);
+			if (useFrustumCulling)
+			{
+				Lane rw = LaneMul(r, c.w), rn = LaneSub(zero, rw);
+				radius = LaneMul(radius, scale);
+				outside |= LaneLess(LaneAdd(c.x, radius), rn) | LaneGreater(LaneSub(c.x, radius), rw);
+				outside |= LaneLess(LaneAdd(c.y, radius), rn) | LaneGreater(LaneSub(c.y, radius), rw);
+				outside |= LaneLess(LaneAdd(c.z, radius), rn) | LaneGreater(LaneSub(c.z, radius), rw);
+			}
+
+			StoreVisibleLanes(visible, i, outside);
+		}
+
+		for (; i < count; i++)
+		{
+			SphereBounds4 bound(Vector4(centers[0][i], centers[1][i], centers[2][i], centers[3][i]), radii[i]);
+			if (IsSphereInFrustum(bound))
+				visible[i / 32] |= 1u << (i % 32);
 		}
 	}
 
-	void Frustum4::Project(const Buffer4 &source, const Transform4 &transform, Visualizer4 *dest)
+	template <class V>
+	void Frustum4::Project(const Buffer4 &source, const Transform4 &transform, V *dest)
 	{
 		viewmodel = view * transform;
 		auto v4 = source.vertices;
@@ -354,9 +661,47 @@ namespace Forth
 		EnsureCapacity(&sides, 0, &sides_cap, v4c);
 		EnsureCapacity(&vmverts, 0, &vmverts_cap, v4c);
 
-		// Predetect vertex sides on plane
-		for (int i = 0; i < v4c; i++)
-			sides[i] = GetSideTest(vmverts[i] = viewmodel * v4[i]);
+		// Predetect vertex outcodes, LaneWidth vertices at once
+		const TransformLanes4 vm(viewmodel);
+		const Lane nearW = LaneSet(nearClip), farW = LaneSet(farClip), r = LaneSet(ratio), zero = LaneSet(0.f);
+		const bool soa = source.HasLanes();
+		int i = 0;
+
+		for (; i + LaneWidth <= v4c; i += LaneWidth)
+		{
+			VectorLanes4 v = vm * (soa ? LoadLanes(source.lanes, i) : LoadLanes(v4 + i));
+			StoreLanes(vmverts + i, v);
+
+			// Same test as GetSide(), one mask per flag
+			int masks[8] = {0, 0, 0, 0, 0, 0, LaneLess(v.w, nearW), 0};
+			masks[7] = LaneGreater(v.w, farW) & ~masks[6];
+			if (useFrustumCulling)
+			{
+				Lane rw = LaneMul(r, v.w), rn = LaneSub(zero, rw);
+				const Lane *axes[3] = {&v.x, &v.y, &v.z};
+				for (int k = 0; k < 3; ++k)
+				{
+					masks[k * 2] = LaneLess(*axes[k], rn);
+					masks[k * 2 + 1] = LaneGreater(*axes[k], rw);
+				}
+			}
+
+			for (int j = 0; j < LaneWidth; ++j)
+			{
+				int flag = 0;
+				for (int k = 0; k < 8; ++k)
+					flag |= ((masks[k] >> j) & 1) << k;
+				sides[i + j] = flag;
+			}
+		}
+
+		for (; i < v4c; i++)
+			sides[i] = GetSide(vmverts[i] = viewmodel * v4[i]);
+
+		// Let the visualizer allocate once before the output is filled
+		int polygons, points;
+		InternalCount(source, &polygons, &points);
+		dest->Reserve(polygons, points);
 
 		switch (source.simplex)
 		{
@@ -370,7 +715,59 @@ namespace Forth
 			InternalProject3(source, dest);
 			break;
 		case SM_Tetrahedron:
+			InternalProject4(source, dest);
+			break;
+		}
+	}
+
+	template void Frustum4::Project(const Buffer4 &, const Transform4 &, Visualizer4 *);
+	template void Frustum4::Project(const Buffer4 &, const Transform4 &, ParticleVisualizer *);
+	template void Frustum4::Project(const Buffer4 &, const Transform4 &, WireVisualizer *);
+	template void Frustum4::Project(const Buffer4 &, const Transform4 &, SolidVisualizer *);
+	template void Frustum4::Project(const Buffer4 &, const Transform4 &, GLVisualizer *);
+
+	void Frustum4::Project(const Buffer4 &source, const Transform4 &transform, Visualizer4 *dest)
+	{
+		Project<Visualizer4>(source, transform, dest);
+	}
+
+	void Frustum4::Project(const Buffer4 &source, const Transform4 &transform, BufferGL &dest)
+	{
+		GLVisualizer viz;
+		viz.Initialize(dest, SimplexModeForVisualizing(source.simplex));
+		Project(source, transform, &viz);
+		viz.End();
+	}
+
+	void Frustum4::Project(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest)
+	{
+		// Default visualizers are known, so skip the virtual calls
+		switch (SimplexModeForVisualizing(source.simplex))
+		{
+		case SM_Point:
+		{
+			ParticleVisualizer *viz = (ParticleVisualizer *)defaultVisualizers[SM_Point];
+			viz->Initialize(dest);
+			Project(source, transform, viz);
+			viz->End();
+			break;
+		}
+		case SM_Line:
+		{
+			WireVisualizer *viz = (WireVisualizer *)defaultVisualizers[SM_Line];
+			viz->Initialize(dest);
+			Project(source, transform, viz);
+			viz->End();
 			break;
 		}
+		default:
+		{
+			SolidVisualizer *viz = (SolidVisualizer *)defaultVisualizers[SM_Triangle];
+			viz->Initialize(dest);
+			Project(source, transform, viz);
+			viz->End();
+			break;
+		}
+		}
 	}
 } // namespace Forth
\ No newline at end of file
@@ -15,12 +15,19 @@ namespace Forth
 		Plane4 yMaxPlane, yMinPlane;
 		Plane4 zMaxPlane, zMinPlane;
 
-		bool *sides = new bool[4];
+		// GetSide() outcode of every vertex, zero when inside
+		unsigned char *sides = new unsigned char[4];
 		int sides_cap = 4;
 		Vector4 *vmverts = new Vector4[4];
 		int vmverts_cap = 4;
-		Vector4 _temp[9];
-		Vector4 _temp2[9];
+		// A clipped triangle gains at most one vertex per frustum plane
+		Vector4 _temp[12];
+		Vector4 _temp2[12];
+
+		// Clipped tetrahedron as a convex polytope, which gains at most one face per frustum plane
+		Vector4 _faces[12][16];
+		int _faceCounts[12];
+		Vector4 _cap[16];
 
 	  public:
 		enum FrustumCase
@@ -94,17 +101,42 @@ namespace Forth
 
 		// 0x1=x- 0x2=x+ 0x4=y- 0x8=y+ 0x10=z- 0x20=z+
 		// 0x40=w- 0x80=w+ 0 = inside. Can be Multiflagged
-		int GetSide(const Vector4 &v);
+		int GetSide(const Vector4 &v) const;
 
 		bool GetSideTest(const Vector4 &v) const;
 
+		// Signed distance to a frustum plane, positive outside.
+		// Planes are indexed in the same order as GetSide() flags.
+		float GetDistance(int plane, const Vector4 &v) const;
+
+		// Clip a convex polygon with a frustum plane into result, which holds capacity points.
+		// If caps is given, points lying on the plane are added to _cap.
+		int ClipPolygon(int plane, const Vector4 input[], int length, Vector4 result[], int capacity, int *caps = NULL);
+
+		// Clip tetrahedron (view space) into _faces with planes flagged as GetSide(), return the face count.
+		// Faces are wound so that Cross(p1 - p0, p2 - p0, Cross(b - a, c - a, d - a)) points out of the polytope,
+		// hence mirrored tetrahedrons come out with reversed faces.
+		int ClipTetrahedron(const Vector4 &a, const Vector4 &b, const Vector4 &c, const Vector4 &d, int planes);
+
+		// Does the polygon, lying in a tetrahedron hyperplane of given normal, wind towards the inner point?
+		static bool IsFlipped(const Vector4 *points, int count, const Vector4 &normal, const Vector4 &inner);
+
+		// Count polygons that will be emitted and an upper bound of their vertices
+		void InternalCount(const Buffer4 &source, int *polygons, int *points) const;
+
 		// Internal separate projection methods
 
-		void InternalProject1(const Buffer4 &source, Visualizer4 *dest);
+		template <class V>
+		void InternalProject1(const Buffer4 &source, V *dest);
 
-		void InternalProject2(const Buffer4 &source, Visualizer4 *dest);
+		template <class V>
+		void InternalProject2(const Buffer4 &source, V *dest);
 
-		void InternalProject3(const Buffer4 &source, Visualizer4 *dest);
+		template <class V>
+		void InternalProject3(const Buffer4 &source, V *dest);
+
+		template <class V>
+		void InternalProject4(const Buffer4 &source, V *dest);
 
 		static FrustumCase GetCase(bool a)
 		{
@@ -131,6 +163,11 @@ namespace Forth
 		// Keep culling fast by assuming the bound is a sphere
 		bool IsSphereInFrustum(const SphereBounds4 &bound) const;
 
+		/// <summary>
+		/// Same test as IsSphereInFrustum(), LaneWidth spheres at once
+		/// </summary>
+		void CullSpheres(const float *const centers[4], const float *radii, int count, unsigned int *visible) const override;
+
 		///
 
 		Vector3 Project(const Vector4 &v) const override
@@ -147,15 +184,35 @@ namespace Forth
 		}
 
 		/// <summary>
-		/// This method always return the same simplex mode.
+		/// This method return the same simplex mode, except tetrahedrons which are visualized by their faces.
 		/// </summary>
 		SimplexMode SimplexModeForVisualizing(SimplexMode mode) const override
 		{
-			return mode;
+			return mode == SM_Tetrahedron ? SM_Triangle : mode;
 		}
 
 		void Project(const Buffer4 &source, const Transform4 &transform, Visualizer4 *dest) override;
 
+		/// <summary>
+		/// Projection into a known visualizer type, letting per-simplex calls inline.
+		/// </summary>
+		/// <remarks>
+		/// Instantiated for the built-in visualizers and Visualizer4,
+		/// the latter being the same as the virtual overload.
+		/// </remarks>
+		template <class V>
+		void Project(const Buffer4 &source, const Transform4 &transform, V *dest);
+
+		/// <summary>
+		/// Projection straight into GPU layout, skipping Buffer3
+		/// </summary>
+		void Project(const Buffer4 &source, const Transform4 &transform, BufferGL &dest) override;
+
+		/// <summary>
+		/// Dynamic projection with default visualizer
+		/// </summary>
+		void Project(const Buffer4 &source, const Transform4 &transform, Buffer3 &dest) override;
+
 		~Frustum4()
 		{
 			delete[] sides;
@@ -3,12 +3,17 @@
 #include "../common/Buffer3.h"
 #include "../common/Buffer4.h"
 #include "../common/BufferGL.h"
+#include "../common/MeshFile.h"
 #include "../math/Transform4.h"
 #include "../physics/dynamics/Body.h"
 #include "Projector4.h"
+#include "SceneTree.h"
+#include <climits>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 #include <stdio.h>
+#include <string>
 
 /** OpenGL Drawing Macro
  *
@@ -22,101 +27,340 @@
 		glBufferData(GL_ARRAY_BUFFER,                                                    \
 					 dr.vb_count * sizeof(float),                                        \
 					 &dr.vb[0], GL_STREAM_DRAW);                                         \
-		int __f_offsets__ = 0;                                                           \
+		_FORTH_GL_ATTRIB(dr, 0);                                                         \
+		glDrawArrays(_FORTH_GL_MODE(dr), 0, dr.attr.vertexs);                            \
+	} while (0)
+
+/** Point attributes to the bound vertex buffer, vertices starting at given byte offset */
+#define _FORTH_GL_ATTRIB(dr, offset)                                                     \
+	do                                                                                   \
+	{                                                                                    \
 		for (int __f_iter__ = 0; __f_iter__ < dr.attr.slots; ++__f_iter__)               \
 		{                                                                                \
+			const Forth::AttributeFormat __f_format__ = dr.attr.formats[__f_iter__];     \
 			glEnableVertexAttribArray(__f_iter__);                                       \
 			glVertexAttribPointer(__f_iter__,                                            \
-								  dr.attr.counts[__f_iter__], GL_FLOAT, GL_FALSE,        \
-								  dr.attr.stripe * sizeof(float),                        \
-								  (void *)(__f_offsets__ * sizeof(float)));              \
-			__f_offsets__ += dr.attr.counts[__f_iter__];                                 \
+								  dr.attr.counts[__f_iter__],                            \
+								  _FORTH_GL_TYPE(__f_format__),                          \
+								  __f_format__ == Forth::AF_Float ? GL_FALSE : GL_TRUE,  \
+								  dr.attr.stride,                                        \
+								  (void *)((offset) + dr.attr.offsets[__f_iter__]));     \
 		}                                                                                \
-		glDrawArrays(dr.attr.simplex == 3 ? GL_TRIANGLES                                 \
-										  : dr.attr.simplex == 2 ? GL_LINES : GL_POINTS, \
-					 0, dr.attr.vertexs);                                                \
+	} while (0)
+
+#define _FORTH_GL_TYPE(format)                                        \
+	(format == Forth::AF_Float ? GL_FLOAT                             \
+							   : format == Forth::AF_Packed ? GL_INT_2_10_10_10_REV : GL_SHORT)
+
+#define _FORTH_GL_MODE(dr) \
+	(dr.attr.simplex == 3 ? GL_TRIANGLES : dr.attr.simplex == 2 ? GL_LINES : GL_POINTS)
+
+/** Draw from bound buffers, through indices at given byte offset if indexed */
+#define _FORTH_GL_DRAW_ELEMENTS(dr, offset)                                              \
+	do                                                                                   \
+	{                                                                                    \
+		if (dr.IsIndexed())                                                              \
+			glDrawElements(_FORTH_GL_MODE(dr), dr.attr.indexs,                           \
+						   dr.attr.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, \
+						   (void *)(offset));                                            \
+		else                                                                             \
+			glDrawArrays(_FORTH_GL_MODE(dr), 0, dr.attr.vertexs);                        \
 	} while (0)
 
 #define FORTH_GL_DRAW(model, vb) _FORTH_GL_DRAW((model).driver, vb)
 
+/** Indexed OpenGL Drawing Macro, for drivers with generate.indexed set
+ *
+ * @model Model4
+ * @vb GLuint to a vertex buffer
+ * @ib GLuint to an element buffer
+*/
+#define FORTH_GL_DRAW_INDEXED(model, vb, ib)                                             \
+	do                                                                                   \
+	{                                                                                    \
+		const Forth::BufferGL &__f_dr__ = (model).driver;                                \
+		glBindBuffer(GL_ARRAY_BUFFER, vb);                                               \
+		glBufferData(GL_ARRAY_BUFFER,                                                    \
+					 __f_dr__.vb_count * sizeof(float),                                  \
+					 &__f_dr__.vb[0], GL_STREAM_DRAW);                                   \
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib);                                       \
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER,                                            \
+					 __f_dr__.IndexBytes(), __f_dr__.ib, GL_STREAM_DRAW);                \
+		_FORTH_GL_ATTRIB(__f_dr__, 0);                                                   \
+		_FORTH_GL_DRAW_ELEMENTS(__f_dr__, 0);                                            \
+	} while (0)
+
+/** Streamed OpenGL Drawing Macro, without reuploading
+ *
+ * @model Model4
+ * @target GLStreamTarget the model's driver was pushed to
+ * @offset Byte offset returned by StreamBuffer::Push()
+*/
+#define FORTH_GL_DRAW_STREAM(model, target, offset)                                      \
+	do                                                                                   \
+	{                                                                                    \
+		glBindBuffer(GL_ARRAY_BUFFER, (target).vb);                                      \
+		_FORTH_GL_ATTRIB((model).driver, (size_t)(offset));                              \
+		glDrawArrays(_FORTH_GL_MODE((model).driver), 0, (model).driver.attr.vertexs);    \
+	} while (0)
+
+/** Streamed indexed OpenGL Drawing Macro
+ *
+ * @model Model4
+ * @target GLStreamTarget the model's driver was pushed to
+ * @offset Byte offset returned by StreamBuffer::Push()
+ * @index_offset Byte offset returned by StreamBuffer::PushIndices()
+*/
+#define FORTH_GL_DRAW_STREAM_INDEXED(model, target, offset, index_offset)                \
+	do                                                                                   \
+	{                                                                                    \
+		glBindBuffer(GL_ARRAY_BUFFER, (target).vb);                                      \
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, (target).vb);                              \
+		_FORTH_GL_ATTRIB((model).driver, (size_t)(offset));                              \
+		_FORTH_GL_DRAW_ELEMENTS((model).driver, (size_t)(index_offset));                 \
+	} while (0)
+
 namespace Forth
 {
 	class Model4
 	{
+		friend class Scene4;
+
 	protected:
 		Transform4 matrix;
 		bool matrix_dirty = true;
 		unsigned long cached_view_version = ULONG_MAX;
+		unsigned long cached_input_version = ULONG_MAX;
 		SphereBounds4 bounds;
 		bool bounds_valid = false;
+		unsigned long bounds_version = ULONG_MAX;
+		bool culled = false;
+		ProjectionCache *cache = NULL;
+
+		// Leaf in the scene tree this model was added to, if any
+		SceneTree *tree = NULL;
+		int proxy = -1;
+
+		// Slot in Scene4::models when added through Scene4::Add()
+		std::vector<Model4 *> *list = NULL;
+		int slot = -1;
+
+		// Leave the scene this model was added to, swapping the last model into its slot
+		void Detach(void)
+		{
+			if (tree)
+				tree->Remove(proxy);
+			tree = NULL;
+			proxy = -1;
+
+			if (list && slot < (int)list->size() && (*list)[slot] == this)
+			{
+				Model4 *last = list->back();
+				(*list)[slot] = last;
+				last->slot = slot;
+				list->pop_back();
+			}
+			list = NULL;
+			slot = -1;
+		}
+
+		// Set when back buffers hold a newer frame than driver and output
+		bool back_ready = false;
+		bool back_culled = false;
+
+		// Project into given buffers if anything changed since last time, return true if so
+		bool Update(Projector4 &projector, Buffer3 &out, BufferGL &drv, bool *cull)
+		{
+			if (!matrix_dirty && cached_view_version == projector.view_version && cached_input_version == input.version)
+				return false;
+
+			*cull = projector.IsCullable(GetWorldBounds());
+
+			if (*cull)
+			{
+				out.Clear();
+				drv.Clear();
+			}
+			else if (keepOutput)
+			{
+				projector.Project(input, matrix, out, incremental ? &cache : NULL);
+				drv.Copy(out);
+			}
+			else
+				projector.Project(input, matrix, drv, incremental ? &cache : NULL);
+
+			matrix_dirty = false;
+			cached_view_version = projector.view_version;
+			cached_input_version = input.version;
+			return true;
+		}
 
 	  public:
-		Buffer4 input = Buffer4();
+		Buffer4 input;
 		Buffer3 output = Buffer3();
 		BufferGL driver = BufferGL();
 		Physics::Body *rigidbody = NULL;
 
+		/// <summary>
+		/// Second output and driver, filled by RenderBack() while the first pair is drawn.
+		/// </summary>
+		Buffer3 backOutput = Buffer3();
+		BufferGL backDriver = BufferGL();
+
+		/// <summary>
+		/// Keep the sliced Buffer3 in output, copied to driver afterwards.
+		/// Clear it to write slices straight into driver, skipping the copy but leaving output empty.
+		/// </summary>
+		bool keepOutput = true;
+
+		/// <summary>
+		/// Let the projector keep per-model state between frames,
+		/// so frames where only the view W offset changes are cheaper to project.
+		/// </summary>
+		/// <remarks>
+		/// Costs a copy of transformed vertices, worth it for large models being scrubbed along W.
+		/// </remarks>
+		bool incremental = false;
+
 		Model4(void) : matrix(Vector4(), Matrix4(1)) {}
 
+		/// <remarks>
+		/// A model still added to a Scene4 leaves it, so the scene never visits a dangling model.
+		/// Models pushed straight into Scene4::models must be removed from there by hand.
+		/// </remarks>
+		~Model4(void)
+		{
+			Detach();
+			delete cache;
+		}
+
 		const Transform4& GetModelMatrix() { return matrix; }
 		void SetModelMatrix(const Transform4& value) {
 			matrix = value; matrix_dirty = true;
+			if (tree != NULL)
+				tree->Update(proxy, GetWorldBox());
 			if (rigidbody != NULL)
 				rigidbody->SetTransform(value);
 		}
 
-		void Render(Projector4 &projector)
+		/// <summary>
+		/// Bounding sphere of input in model space, recomputed only when input changes.
+		/// </summary>
+		const SphereBounds4 &GetBounds()
 		{
-			if (matrix_dirty || cached_view_version != projector.view_version)
+			if (!bounds_valid || bounds_version != input.version)
 			{
-				projector.Project(input, matrix, output);
-				this->driver.Copy(output);
-				matrix_dirty = false;
-				cached_view_version = projector.view_version;
+				bounds = input.GetBounds();
+				bounds_valid = true;
+				bounds_version = input.version;
 			}
+			return bounds;
 		}
 
-		bool ReadStreamOBJ(std::istream &stream)
+		/// <summary>
+		/// Bounding sphere of input in world space.
+		/// </summary>
+		SphereBounds4 GetWorldBounds()
 		{
-			input.Clear();
+			const SphereBounds4 &b = GetBounds();
+			const Matrix4 &r = matrix.rotation;
+			// Largest axis scale, in case the rotation isn't orthonormal
+			float scale = Max(Max(LengthSq(r.Column0()), LengthSq(r.Column1())),
+							  Max(LengthSq(r.Column2()), LengthSq(r.Column3())));
+			return SphereBounds4(matrix * b.center, b.radius * Sqrt(scale));
+		}
 
-			while (1)
-			{
+		/// <summary>
+		/// Box around GetWorldBounds().
+		/// </summary>
+		Bounds4 GetWorldBox()
+		{
+			SphereBounds4 b = GetWorldBounds();
+			return Bounds4(b.center - Vector4(b.radius), b.center + Vector4(b.radius));
+		}
 
-				char lineHeader[128];
-				// read the first word of the line
-				stream >> lineHeader;
-				if (stream.eof())
-					break; // EOF = End Of File. Quit the loop.
+		/// <summary>
+		/// Was the model culled out during last Render()?
+		/// </summary>
+		bool IsCulled() const { return culled; }
 
-				// else : parse lineHeader
+		/// <summary>
+		/// Project input into driver (and output if kept), unless culled.
+		/// Returns false if there's nothing to draw.
+		/// </summary>
+		bool Render(Projector4 &projector)
+		{
+			Update(projector, output, driver, &culled);
+			return !culled;
+		}
 
-				if (strcmp(lineHeader, "v") == 0)
-				{
-					Vector4 vertex;
+		/// <summary>
+		/// Same as Render(), but into backDriver (and backOutput), leaving driver untouched.
+		/// Call Present() afterwards to bring the result to driver.
+		/// </summary>
+		/// <remarks>
+		/// Safe to run on another thread while driver is drawn,
+		/// as long as nothing else touches this model or the projector meanwhile.
+		/// </remarks>
+		void RenderBack(Projector4 &projector)
+		{
+			if (Update(projector, backOutput, backDriver, &back_culled))
+				back_ready = true;
+		}
 
-					stream >> vertex.x >> vertex.y >> vertex.z >> vertex.w;
+		/// <summary>
+		/// Swap in the frame made by last RenderBack(), if any.
+		/// Returns false if there's nothing to draw.
+		/// </summary>
+		bool Present()
+		{
+			if (back_ready)
+			{
+				output.Swap(backOutput);
+				driver.Swap(backDriver);
+				culled = back_culled;
+				back_ready = false;
+			}
+			return !culled;
+		}
 
-					input.AddVertex(vertex);
-				}
-				else if (strcmp(lineHeader, "f") == 0)
-				{
-					int indices[4];
+		/// <summary>
+		/// Load input from the text format written by WriteStreamOBJ().
+		/// The whole stream is read first, then parsed in parallel (see ReadMeshOBJ()).
+		/// </summary>
+		bool ReadStreamOBJ(std::istream &stream, int threads = 0)
+		{
+			std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+			return ReadMeshOBJ(data.data(), data.size(), input, threads);
+		}
 
-					stream >> indices[0] >> indices[1] >> indices[2] >> indices[3];
+		/// <summary>
+		/// Load input from a binary mesh file (see MeshFile.h), mapping it instead of parsing text.
+		/// </summary>
+		bool ReadFile(const char *path)
+		{
+			SphereBounds4 b;
+			if (!ReadMeshFile(path, input, &b))
+				return false;
 
-					input.AddSimplex(indices[0], indices[1], indices[2], indices[3]);
-				}
-				else
-				{
-					// Probably a comment, eat up the rest of the line
-					stream.get();
-				}
+			// Bounds stored in the file spare a pass over vertices
+			if (b.radius > 0)
+			{
+				bounds = b;
+				bounds_valid = true;
+				bounds_version = input.version;
 			}
-
 			return true;
 		}
 
+		/// <summary>
+		/// Binary counterpart of WriteStreamOBJ(), stream must be opened in binary mode.
+		/// </summary>
+		bool WriteStream(std::ostream &stream, bool apply_matrix = false)
+		{
+			return WriteMeshFile(stream, input, apply_matrix ? &matrix : NULL);
+		}
+
 		bool WriteStreamOBJ(std::ostream &stream, bool apply_matrix = false)
 		{
 			stream << "# Forth Engine Modified OBJ Format" << std::endl;
@@ -13,6 +13,26 @@ namespace Forth
 		viz->End();
 	}
 
+	void Projector4::Project(const Buffer4 &from, const Transform4 &transform, BufferGL &to)
+	{
+		GLVisualizer viz;
+		viz.Initialize(to, this->SimplexModeForVisualizing(from.simplex));
+		this->Project(from, transform, &viz);
+		viz.End();
+	}
+
+	void Projector4::CullSpheres(const float *const centers[4], const float *radii, int count, unsigned int *visible) const
+	{
+		memset(visible, 0, ((count + 31) / 32) * sizeof(unsigned int));
+
+		for (int i = 0; i < count; i++)
+		{
+			SphereBounds4 bound(Vector4(centers[0][i], centers[1][i], centers[2][i], centers[3][i]), radii[i]);
+			if (!IsCullable(bound))
+				visible[i / 32] |= 1u << (i % 32);
+		}
+	}
+
 	Projector4::Projector4()
 	{
 		defaultVisualizers[SM_Point] = new ParticleVisualizer();
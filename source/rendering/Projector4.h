@@ -4,6 +4,7 @@
 #include "../math/SphereBounds4.h"
 #include "../math/Transform4.h"
 #include "../math/Vector3.h"
+#include "../visualizer/GLVisualizer.h"
 #include "../visualizer/ParticleVisualizer.h"
 #include "../visualizer/SolidVisualizer.h"
 #include "../visualizer/WireVisualizer.h"
@@ -11,6 +12,14 @@
 
 namespace Forth
 {
+	/// <summary>
+	/// State a projector keeps for one model between frames, owned by the model.
+	/// </summary>
+	struct ProjectionCache
+	{
+		virtual ~ProjectionCache(void) {}
+	};
+
 	/// <summary>
 	/// Base class to handle projection from 4D to 3D
 	/// </summary>
@@ -47,6 +56,17 @@ namespace Forth
 		/// </summary>
 		virtual bool IsCullable(const SphereBounds4 &bound) const = 0;
 
+		/// <summary>
+		/// Cull many static objects at once, their sphere centers given as structure-of-arrays (x, y, z, w).
+		/// Bit (i % 32) of visible[i / 32] is set when sphere i can't be culled out.
+		/// </summary>
+		/// <remarks>
+		/// The default implementation calls IsCullable() for every sphere.
+		/// Meant for callers holding their own flat lists of objects:
+		/// Scene4 culls through SceneTree, one IsCullable() call per visited node.
+		/// </remarks>
+		virtual void CullSpheres(const float *const centers[4], const float *radii, int count, unsigned int *visible) const;
+
 		/// <summary>
 		/// Adapt to simplex requirement for this projection.
 		/// </summary>
@@ -57,6 +77,31 @@ namespace Forth
 		/// </summary>
 		virtual void Project(const Buffer4 &from, const Transform4 &transform, Buffer3 &to);
 
+		/// <summary>
+		/// Dynamic projection written straight into GPU layout
+		/// </summary>
+		virtual void Project(const Buffer4 &from, const Transform4 &transform, BufferGL &to);
+
+		/// <summary>
+		/// Projection with default visualizer, reusing per-model state kept in cache.
+		/// </summary>
+		/// <remarks>
+		/// The projector creates (or replaces) *cache as it sees fit, NULL skips caching.
+		/// The default implementation doesn't cache anything.
+		/// </remarks>
+		virtual void Project(const Buffer4 &from, const Transform4 &transform, Buffer3 &to, ProjectionCache ** /*cache*/)
+		{
+			Project(from, transform, to);
+		}
+
+		/// <summary>
+		/// Projection straight into GPU layout, reusing per-model state kept in cache.
+		/// </summary>
+		virtual void Project(const Buffer4 &from, const Transform4 &transform, BufferGL &to, ProjectionCache ** /*cache*/)
+		{
+			Project(from, transform, to);
+		}
+
 	  protected:
 		void *defaultVisualizers[3];
 
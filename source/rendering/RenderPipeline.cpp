@@ -0,0 +1,76 @@
+#include "RenderPipeline.h"
+
+namespace Forth
+{
+	RenderPipeline::RenderPipeline(void)
+	{
+		worker = std::thread(&RenderPipeline::Run, this);
+	}
+
+	RenderPipeline::~RenderPipeline(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_one();
+		worker.join();
+	}
+
+	void RenderPipeline::Run(void)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			wake.wait(lock, [this] { return quit || completed != submitted; });
+			if (quit)
+				return;
+
+			// Batch is left alone by the caller until completed, so no need to hold the lock
+			lock.unlock();
+			for (Model4 *model : models)
+				model->RenderBack(*projector);
+			lock.lock();
+
+			completed = submitted;
+			finished.notify_all();
+		}
+	}
+
+	RenderFence RenderPipeline::Submit(const std::vector<Model4 *> &models, Projector4 &projector)
+	{
+		Wait(submitted);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->models = models;
+			this->projector = &projector;
+			++submitted;
+		}
+		wake.notify_one();
+
+		return submitted;
+	}
+
+	bool RenderPipeline::IsDone(RenderFence fence)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return completed >= fence;
+	}
+
+	void RenderPipeline::Wait(RenderFence fence)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [this, fence] { return completed >= fence; });
+
+		// Only one batch is in flight, so once it's done the worker is idle and models are safe to swap.
+		// Older fences were already presented by Submit().
+		if (presented < completed && completed == submitted)
+		{
+			for (Model4 *model : models)
+				model->Present();
+			presented = completed;
+		}
+	}
+} // namespace Forth
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Model4.h"
+#include "Projector4.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Forth
+{
+	/// <summary>
+	/// Handle to a batch submitted to RenderPipeline, increasing with every Submit()
+	/// </summary>
+	typedef unsigned long RenderFence;
+
+	///
+	/// Projects the next frame of models on a background thread while the current one is drawn.
+	/// There is exactly one worker thread, going through the batch's models in order.
+	///
+	/// Typical frame:
+	///   pipeline.Wait(fence);                     // previous batch is now in every model's driver
+	///   projector.SetViewMatrix(next);
+	///   fence = pipeline.Submit(models, projector);
+	///   draw every model through FORTH_GL_DRAW    // overlaps with the projection
+	///
+	class RenderPipeline
+	{
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable wake, finished;
+
+		// Batch being projected, only one is in flight at a time
+		std::vector<Model4 *> models;
+		Projector4 *projector = NULL;
+
+		RenderFence submitted = 0, completed = 0, presented = 0;
+		bool quit = false;
+
+		void Run(void);
+
+	  public:
+		RenderPipeline(void);
+
+		~RenderPipeline(void);
+
+		/// <summary>
+		/// Start projecting given models into their back buffers with the projector's current view.
+		/// </summary>
+		/// <remarks>
+		/// A batch still in flight is waited for (and presented) first.
+		/// Until the returned fence is reached, neither the models nor the projector may be touched,
+		/// except for drawing from models' driver.
+		/// Projection is multithreaded according to the projector's own settings (e.g. CrossSection::threads).
+		/// </remarks>
+		RenderFence Submit(const std::vector<Model4 *> &models, Projector4 &projector);
+
+		/// <summary>
+		/// Has the batch behind given fence finished projecting?
+		/// </summary>
+		bool IsDone(RenderFence fence);
+
+		/// <summary>
+		/// Block until the batch behind given fence is projected, then present it to models' driver.
+		/// </summary>
+		void Wait(RenderFence fence);
+	};
+} // namespace Forth
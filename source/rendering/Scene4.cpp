@@ -0,0 +1,80 @@
+#include "Scene4.h"
+#include <algorithm>
+
+namespace Forth
+{
+	Scene4::Scene4(void)
+	{
+	}
+
+	Scene4::~Scene4()
+	{
+		// Models may outlive the scene, don't let them detach from it later
+		for (Model4 *model : models)
+		{
+			if (model->list == &models)
+			{
+				model->tree = NULL;
+				model->list = NULL;
+			}
+		}
+	}
+
+	void Scene4::Add(Model4 *model)
+	{
+		model->Detach();
+		model->list = &models;
+		model->slot = (int)models.size();
+		models.push_back(model);
+		model->tree = &tree;
+		model->proxy = tree.Insert(model->GetWorldBox(), model);
+	}
+
+	void Scene4::Remove(Model4 *model)
+	{
+		if (model->list == &models)
+		{
+			model->Detach();
+			return;
+		}
+
+		// Pushed straight into models
+		auto it = std::find(models.begin(), models.end(), model);
+		if (it != models.end())
+			models.erase(it);
+	}
+
+	void Scene4::Update(Model4 *model)
+	{
+		if (model->tree == &tree)
+			tree.Update(model->proxy, model->GetWorldBox());
+	}
+
+	int Scene4::Render(Projector4 &projector)
+	{
+		visible.clear();
+
+		if (tree.count != (int)models.size())
+		{
+			// Some models were pushed directly, visit them all
+			for (Model4 *model : models)
+			{
+				if (model->Render(projector))
+					visible.push_back(model);
+			}
+		}
+		else
+		{
+			tree.Query(projector, [&](Model4 *model) {
+				if (model->Render(projector))
+					visible.push_back(model);
+			});
+		}
+
+		if (batching)
+			batch.Build(visible);
+
+		return (int)visible.size();
+	}
+
+} // namespace Forth
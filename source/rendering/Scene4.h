@@ -1,6 +1,8 @@
 #pragma once
 
+#include "../physics/dynamics/Scene.h"
 #include "Model4.h"
+#include "SceneBatch.h"
 #include <vector>
 
 namespace Forth
@@ -11,16 +13,65 @@ namespace Forth
 		std::vector<Model4*> models;
 		Physics::Scene physics;
 
+		/// <summary>
+		/// Hierarchy over world bounds of models added through Add().
+		/// </summary>
+		SceneTree tree;
+
+		/// <summary>
+		/// Models rendered (not culled) during last Render().
+		/// </summary>
+		std::vector<Model4*> visible;
+
+		/// <summary>
+		/// Drivers of visible models merged by last Render(), if batching.
+		/// Draw it with FORTH_GL_DRAW_BATCH.
+		/// </summary>
+		SceneBatch batch;
+
+		/// <summary>
+		/// Fill batch at the end of every Render().
+		/// </summary>
+		/// <remarks>
+		/// Every visible driver is copied again each frame, changed or not,
+		/// which costs about as much as uploading them all. Worth it when draw calls are the bottleneck.
+		/// </remarks>
+		bool batching = false;
+
 		Scene4(void);
 		~Scene4();
-	};
 
-	Scene4::Scene4(void)
-	{
-	}
+		/// <summary>
+		/// Add a model to models and to the tree.
+		/// </summary>
+		/// <remarks>
+		/// The tree follows SetModelMatrix(). After editing its input, call Update().
+		/// A destroyed model removes itself.
+		/// </remarks>
+		void Add(Model4 *model);
 
-	Scene4::~Scene4()
-	{
-	}
+		/// <summary>
+		/// Remove a model from models and from the tree.
+		/// </summary>
+		/// <remarks>
+		/// Constant time for models added through Add(): the last model takes its place in models.
+		/// </remarks>
+		void Remove(Model4 *model);
+
+		/// <summary>
+		/// Refresh the model's bounds in the tree.
+		/// </summary>
+		void Update(Model4 *model);
+
+		/// <summary>
+		/// Render every model, skipping those culled by the projector.
+		/// Returns the amount of visible models.
+		/// </summary>
+		/// <remarks>
+		/// If every model went through Add(), culled subtrees aren't visited at all,
+		/// so their models keep their last output and IsCulled() state. Use visible instead.
+		/// </remarks>
+		int Render(Projector4 &projector);
+	};
 
-} // namespace Forth
\ No newline at end of file
+} // namespace Forth
@@ -0,0 +1,95 @@
+#include "SceneBatch.h"
+
+namespace Forth
+{
+	SceneBatch::~SceneBatch(void)
+	{
+		for (Group *g : groups)
+			delete g;
+	}
+
+	int SceneBatch::Build(const std::vector<Model4 *> &models)
+	{
+		count = 0;
+		layouts.Clear();
+
+		for (Model4 *model : models)
+		{
+			const BufferGL &driver = model->driver;
+			if (driver.attr.vertexs == 0)
+				continue;
+
+			Group &g = Find(driver);
+			const bool indexed = driver.IsIndexed();
+
+			g.firsts.push_back(indexed ? g.buffer.attr.indexs : g.buffer.attr.vertexs);
+			g.counts.push_back(indexed ? driver.attr.indexs : driver.attr.vertexs);
+			g.models.push_back(model);
+			g.buffer.Merge(driver);
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			// Offsets depend on the final index size
+			Group &g = *groups[i];
+			g.buffer.PackIndices();
+			for (int first : g.firsts)
+				g.offsets.push_back((const void *)((size_t)first * g.buffer.attr.indexSize));
+		}
+
+		return count;
+	}
+
+	// Hash of everything BufferGL::SameLayout() compares, never IntHashMap::Empty
+	static uint64_t LayoutKey(const BufferGL &driver)
+	{
+		uint64_t k = IntHashMap::Hash(((uint64_t)driver.attr.simplex << 32) | ((uint64_t)driver.attr.slots << 16) |
+									  ((uint64_t)driver.attr.stride << 1) | driver.IsIndexed());
+
+		for (int i = 0; i < driver.attr.slots; i++)
+			k = IntHashMap::Hash(k ^ (((uint64_t)driver.attr.counts[i] << 40) | ((uint64_t)driver.attr.formats[i] << 32) |
+									  (uint32_t)driver.attr.offsets[i]));
+
+		if (driver.attr.formats[0] == AF_Short)
+		{
+			// Same bytes as SameLayout() compares
+			uint32_t bits[6];
+			memcpy(bits, &driver.attr.origin, sizeof(Vector3));
+			memcpy(bits + 3, &driver.attr.extent, sizeof(Vector3));
+			for (uint32_t b : bits)
+				k = IntHashMap::Hash(k ^ b);
+		}
+
+		return k == IntHashMap::Empty ? 0 : k;
+	}
+
+	SceneBatch::Group &SceneBatch::Find(const BufferGL &driver)
+	{
+		// Groups of colliding keys are chained from the last one added
+		bool added;
+		int &head = layouts.Get(LayoutKey(driver), -1, &added);
+
+		for (int i = head; i >= 0; i = chain[i])
+		{
+			if (groups[i]->buffer.SameLayout(driver))
+				return *groups[i];
+		}
+
+		if (count == (int)groups.size())
+		{
+			groups.push_back(new Group());
+			chain.push_back(-1);
+		}
+
+		chain[count] = head;
+		head = count;
+
+		Group &g = *groups[count++];
+		g.buffer.SetupLike(driver);
+		g.firsts.clear();
+		g.counts.clear();
+		g.offsets.clear();
+		g.models.clear();
+		return g;
+	}
+} // namespace Forth
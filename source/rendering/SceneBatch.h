@@ -0,0 +1,133 @@
+#pragma once
+
+#include "../common/BufferGL.h"
+#include "../extras/HashMap.h"
+#include "Model4.h"
+#include <vector>
+
+#if defined(FORTH_GL_NO_MULTIDRAW)
+#define _FORTH_GL_MULTI_DRAW(g)                                                                      \
+	do                                                                                               \
+	{                                                                                                \
+		for (int __f_range__ = 0; __f_range__ < (g).Ranges(); ++__f_range__)                         \
+		{                                                                                            \
+			if ((g).buffer.IsIndexed())                                                              \
+				glDrawElements(_FORTH_GL_MODE((g).buffer), (g).counts[__f_range__],                  \
+							   (g).buffer.attr.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, \
+							   (g).offsets[__f_range__]);                                            \
+			else                                                                                     \
+				glDrawArrays(_FORTH_GL_MODE((g).buffer), (g).firsts[__f_range__],                    \
+							 (g).counts[__f_range__]);                                               \
+		}                                                                                            \
+	} while (0)
+#else
+#define _FORTH_GL_MULTI_DRAW(g)                                                                   \
+	do                                                                                            \
+	{                                                                                             \
+		if ((g).buffer.IsIndexed())                                                               \
+			glMultiDrawElements(_FORTH_GL_MODE((g).buffer), &(g).counts[0],                       \
+								(g).buffer.attr.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, \
+								&(g).offsets[0], (g).Ranges());                                   \
+		else                                                                                      \
+			glMultiDrawArrays(_FORTH_GL_MODE((g).buffer), &(g).firsts[0], &(g).counts[0],         \
+							  (g).Ranges());                                                      \
+	} while (0)
+#endif
+
+/** Batched OpenGL Drawing Macro, one multi-draw call per group.
+ * Define FORTH_GL_NO_MULTIDRAW to draw range by range instead.
+ *
+ * @batch SceneBatch after Build()
+ * @vb GLuint to a vertex buffer
+ * @ib GLuint to an element buffer, only used by indexed groups
+*/
+#define FORTH_GL_DRAW_BATCH(batch, vb, ib)                                                \
+	do                                                                                    \
+	{                                                                                     \
+		for (int __f_group__ = 0; __f_group__ < (batch).GroupCount(); ++__f_group__)      \
+		{                                                                                 \
+			const Forth::SceneBatch::Group &__f_g__ = (batch).GetGroup(__f_group__);      \
+			glBindBuffer(GL_ARRAY_BUFFER, vb);                                            \
+			glBufferData(GL_ARRAY_BUFFER, __f_g__.buffer.vb_count * sizeof(float),        \
+						 __f_g__.buffer.vb, GL_STREAM_DRAW);                              \
+			if (__f_g__.buffer.IsIndexed())                                               \
+			{                                                                             \
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib);                                \
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, __f_g__.buffer.IndexBytes(),        \
+							 __f_g__.buffer.ib, GL_STREAM_DRAW);                          \
+			}                                                                             \
+			_FORTH_GL_ATTRIB(__f_g__.buffer, 0);                                          \
+			_FORTH_GL_MULTI_DRAW(__f_g__);                                                \
+		}                                                                                 \
+	} while (0)
+
+namespace Forth
+{
+	///
+	/// Merges drivers of many models into a few buffers, each drawn with a single multi-draw call.
+	///
+	/// Models are grouped by driver layout (see BufferGL::SameLayout()), looked up through a hash of it.
+	/// Every group holds one range per model, in the order models were given.
+	///
+	class SceneBatch
+	{
+	  public:
+		struct Group
+		{
+			/// <summary>
+			/// Merged vertices (and indices) of every model in this group
+			/// </summary>
+			BufferGL buffer;
+
+			/// <summary>
+			/// First vertex (or index, if indexed) of each range, as glMultiDrawArrays() takes
+			/// </summary>
+			std::vector<int> firsts;
+
+			/// <summary>
+			/// Vertex (or index) count of each range
+			/// </summary>
+			std::vector<int> counts;
+
+			/// <summary>
+			/// Byte offset of each range in the index buffer, as glMultiDrawElements() takes
+			/// </summary>
+			std::vector<const void *> offsets;
+
+			/// <summary>
+			/// Model behind each range
+			/// </summary>
+			std::vector<Model4 *> models;
+
+			int Ranges(void) const { return (int)counts.size(); }
+		};
+
+		SceneBatch(void) {}
+
+		~SceneBatch(void);
+
+		/// <summary>
+		/// Merge drivers of given models, which must be rendered already. Empty drivers are skipped.
+		/// Returns the amount of groups.
+		/// </summary>
+		int Build(const std::vector<Model4 *> &models);
+
+		int GroupCount(void) const { return count; }
+
+		const Group &GetGroup(int i) const { return *groups[i]; }
+
+	  private:
+		// Kept across builds to reuse their storage, only the first count are in use
+		std::vector<Group *> groups;
+		int count = 0;
+
+		// Layout hash to the last group added with it, and from each group to the previous one
+		IntHashMap layouts;
+		std::vector<int> chain;
+
+		Group &Find(const BufferGL &driver);
+
+		SceneBatch(const SceneBatch &) = delete;
+		SceneBatch &operator=(const SceneBatch &) = delete;
+	};
+} // namespace Forth
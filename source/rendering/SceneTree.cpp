@@ -0,0 +1,219 @@
+#include "SceneTree.h"
+
+namespace Forth
+{
+	// Insertion cost of bounds, the 4D analog of a perimeter
+	static inline float Cost(const Bounds4 &b)
+	{
+		Vector4 e = b.max - b.min;
+		return e.x + e.y + e.z + e.w;
+	}
+
+	int SceneTree::Insert(const Bounds4 &aabb, Model4 *data)
+	{
+		int n = AllocateNode();
+		nodes[n].aabb = Fatten(aabb);
+		nodes[n].data = data;
+		nodes[n].height = 0;
+
+		InsertLeaf(n);
+		count++;
+
+		return n;
+	}
+
+	void SceneTree::Remove(int id)
+	{
+		RemoveLeaf(id);
+		DeallocateNode(id);
+		count--;
+	}
+
+	bool SceneTree::Update(int id, const Bounds4 &aabb)
+	{
+		if (nodes[id].aabb.Contains(aabb))
+			return false;
+
+		RemoveLeaf(id);
+		nodes[id].aabb = Fatten(aabb);
+		InsertLeaf(id);
+
+		return true;
+	}
+
+	void SceneTree::InsertLeaf(int id)
+	{
+		if (root == -1)
+		{
+			root = id;
+			nodes[id].parent = -1;
+			return;
+		}
+
+		// Find the cheapest sibling, descending while it's worth it
+		const Bounds4 box = nodes[id].aabb;
+		int index = root;
+
+		while (!nodes[index].IsLeaf())
+		{
+			const Node &n = nodes[index];
+			const float combined = Cost(Combine(n.aabb, box));
+
+			// Cost of pairing here, and of pushing the leaf further down
+			const float cost = 2 * combined, inheritance = 2 * (combined - Cost(n.aabb));
+
+			float costs[2];
+			const int childs[2] = {n.left, n.right};
+			for (int k = 0; k < 2; k++)
+			{
+				const Node &c = nodes[childs[k]];
+				costs[k] = Cost(Combine(box, c.aabb)) + inheritance - (c.IsLeaf() ? 0 : Cost(c.aabb));
+			}
+
+			if (cost < costs[0] && cost < costs[1])
+				break;
+
+			index = costs[0] < costs[1] ? n.left : n.right;
+		}
+
+		// Nodes may reallocate here, so only indices are kept across
+		const int sibling = index, parent = AllocateNode();
+		const int grand = nodes[sibling].parent;
+
+		Node &p = nodes[parent];
+		p.parent = grand;
+		p.left = sibling;
+		p.right = id;
+		p.data = NULL;
+		p.aabb = Combine(box, nodes[sibling].aabb);
+		p.height = nodes[sibling].height + 1;
+
+		if (grand == -1)
+			root = parent;
+		else if (nodes[grand].left == sibling)
+			nodes[grand].left = parent;
+		else
+			nodes[grand].right = parent;
+
+		nodes[sibling].parent = nodes[id].parent = parent;
+
+		SyncHierarchy(parent);
+	}
+
+	void SceneTree::RemoveLeaf(int id)
+	{
+		if (id == root)
+		{
+			root = -1;
+			return;
+		}
+
+		const int parent = nodes[id].parent, grand = nodes[parent].parent;
+		const int sibling = nodes[parent].left == id ? nodes[parent].right : nodes[parent].left;
+
+		// Sibling takes the place of parent
+		if (grand == -1)
+			root = sibling;
+		else if (nodes[grand].left == parent)
+			nodes[grand].left = sibling;
+		else
+			nodes[grand].right = sibling;
+
+		nodes[sibling].parent = grand;
+		DeallocateNode(parent);
+
+		SyncHierarchy(grand);
+	}
+
+	int SceneTree::Balance(int a)
+	{
+		Node &A = nodes[a];
+		if (A.IsLeaf() || A.height < 2)
+			return a;
+
+		const int b = A.left, c = A.right;
+		Node &B = nodes[b], &C = nodes[c];
+		const int balance = C.height - B.height;
+
+		if (balance > 1 || balance < -1)
+		{
+			// Promote the taller child, the shorter grandchild goes down to A
+			const int up = balance > 1 ? c : b, keep = balance > 1 ? b : c;
+			Node &U = nodes[up], &K = nodes[keep];
+			const int f = U.left, g = U.right;
+			Node &F = nodes[f], &G = nodes[g];
+			const int taller = F.height > G.height ? f : g, shorter = taller == f ? g : f;
+
+			U.parent = A.parent;
+			A.parent = up;
+
+			if (U.parent == -1)
+				root = up;
+			else if (nodes[U.parent].left == a)
+				nodes[U.parent].left = up;
+			else
+				nodes[U.parent].right = up;
+
+			U.left = a;
+			U.right = taller;
+
+			if (balance > 1)
+				A.right = shorter;
+			else
+				A.left = shorter;
+			nodes[shorter].parent = a;
+
+			A.aabb = Combine(K.aabb, nodes[shorter].aabb);
+			A.height = Max(K.height, nodes[shorter].height) + 1;
+			U.aabb = Combine(A.aabb, nodes[taller].aabb);
+			U.height = Max(A.height, nodes[taller].height) + 1;
+
+			return up;
+		}
+
+		return a;
+	}
+
+	void SceneTree::SyncHierarchy(int index)
+	{
+		while (index != -1)
+		{
+			index = Balance(index);
+
+			Node &n = nodes[index];
+			n.height = Max(nodes[n.left].height, nodes[n.right].height) + 1;
+			n.aabb = Combine(nodes[n.left].aabb, nodes[n.right].aabb);
+
+			index = n.parent;
+		}
+	}
+
+	int SceneTree::AllocateNode()
+	{
+		if (freeNode == -1)
+		{
+			nodes.push_back(Node());
+			return (int)nodes.size() - 1;
+		}
+
+		int f = freeNode;
+		freeNode = nodes[f].next;
+		nodes[f] = Node();
+		return f;
+	}
+
+	void SceneTree::DeallocateNode(int index)
+	{
+		// Use it as the next free node
+		Node &n = nodes[index];
+		n = Node();
+		n.next = freeNode;
+		freeNode = index;
+	}
+
+	Bounds4 SceneTree::Fatten(const Bounds4 &aabb) const
+	{
+		Vector4 v = Vector4(margin);
+		return Bounds4(aabb.min - v, aabb.max + v);
+	}
+} // namespace Forth
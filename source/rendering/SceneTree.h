@@ -0,0 +1,112 @@
+#pragma once
+
+#include "../math/Bounds4.h"
+#include "../math/SphereBounds4.h"
+#include "Projector4.h"
+#include <vector>
+
+namespace Forth
+{
+	class Model4;
+
+	///
+	/// Dynamic bounding volume tree over models, for culling whole groups of them at once.
+	/// Same idea as Physics::DynamicTree, but kept balanced by rotations.
+	///
+	class SceneTree
+	{
+	  public:
+		struct Node
+		{
+			/// -1 is root
+			int parent = -1;
+			/// -1 is empty (leaf)
+			int left = -1;
+			/// -1 is empty (leaf)
+			int right = -1;
+
+			/// Count of branches this node containing.
+			/// 0 is the leaf, -1 is deallocated
+			int height = -1;
+
+			/// Next free node (deallocated only)
+			int next = -1;
+
+			/// Fattened bounds of this node
+			Bounds4 aabb;
+
+			/// Model attached to this node (leaf only)
+			Model4 *data = NULL;
+
+			bool IsLeaf(void) const { return left == -1; }
+		};
+
+		std::vector<Node> nodes;
+		int root = -1;
+		int freeNode = -1;
+
+		/// Count of leaves
+		int count = 0;
+
+		/// <summary>
+		/// Extra room added around inserted bounds, so small moves don't touch the tree
+		/// </summary>
+		float margin = 0.5f;
+
+		// Provide tight bounds
+		int Insert(const Bounds4 &aabb, Model4 *data);
+
+		void Remove(int id);
+
+		// Returns true if the leaf had to be reinserted
+		bool Update(int id, const Bounds4 &aabb);
+
+		/// <summary>
+		/// Visit models of every leaf that the projector can't cull out.
+		/// Subtrees are rejected by one IsCullable() test on their bounds.
+		/// </summary>
+		template <class F>
+		void Query(const Projector4 &projector, F callback) const
+		{
+			if (root == -1)
+				return;
+
+			// Rotations keep the height logarithmic
+			int stack[128], top = 0;
+			stack[top++] = root;
+
+			while (top > 0)
+			{
+				const Node &n = nodes[stack[--top]];
+
+				if (projector.IsCullable(SphereBounds4(n.aabb.center(), Length(n.aabb.extent()))))
+					continue;
+
+				if (n.IsLeaf())
+					callback(n.data);
+				else
+				{
+					stack[top++] = n.right;
+					stack[top++] = n.left;
+				}
+			}
+		}
+
+	  private:
+		void InsertLeaf(int id);
+
+		void RemoveLeaf(int id);
+
+		// Rotate given node if unbalanced, return the node taking its place
+		int Balance(int index);
+
+		// Correct heights and bounds starting at supplied, balancing on the way up
+		void SyncHierarchy(int index);
+
+		int AllocateNode();
+
+		void DeallocateNode(int index);
+
+		Bounds4 Fatten(const Bounds4 &aabb) const;
+	};
+} // namespace Forth
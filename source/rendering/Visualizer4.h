@@ -16,12 +16,32 @@ namespace Forth
 		/// </summary>
 		virtual void Initialize(Buffer3 &buffer) = 0;
 
+		/// <summary>
+		/// Hint about incoming output: polygon count and their total vertex count
+		/// </summary>
+		virtual void Reserve(int /*polygons*/, int /*points*/) {}
+
 		/// <summary>
 		/// Per-simplex visualize method
 		/// Assume Vector4[] is Vector3[] with w = 0 each
 		/// </summary>
 		virtual void Render(const Vector4 buffer[], int count) = 0;
 
+		/// <summary>
+		/// Can this visualizer take welded (indexed) simplices?
+		/// </summary>
+		virtual bool IsIndexed(void) const { return false; }
+
+		/// <summary>
+		/// Push a vertex to be shared by indexed simplices, return its index
+		/// </summary>
+		virtual int Emit(const Vector4 & /*v*/) { return -1; }
+
+		/// <summary>
+		/// Per-simplex visualize method with indices returned by Emit()
+		/// </summary>
+		virtual void RenderIndexed(const int /*indices*/[], int /*count*/) {}
+
 		/// <summary>
 		/// Marks the end of the visualizing function
 		/// </summary>
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "../common/BufferGL.h"
+#include "../rendering/Visualizer4.h"
+#include <cassert>
+
+namespace Forth
+{
+	/// <summary>
+	/// Writes sliced simplices straight into BufferGL's interleaved layout,
+	/// skipping the intermediate Buffer3 and BufferGL::Copy().
+	/// </summary>
+	class GLVisualizer final : public Visualizer4
+	{
+	  public:
+		GLVisualizer(void) {}
+
+		BufferGL *buff = NULL;
+		SimplexMode simplex = SM_Triangle;
+
+		/// <summary>
+		/// Marks the beginning of the visualizing function
+		/// </summary>
+		void Initialize(BufferGL &buffer, SimplexMode mode)
+		{
+			buff = &buffer;
+			simplex = mode;
+			buff->Setup(mode);
+		}
+
+		/// <summary>
+		/// Buffer3 is left untouched, output goes to the last given BufferGL
+		/// </summary>
+		/// <remarks>
+		/// Initialize(BufferGL &, SimplexMode) must have been called once before.
+		/// </remarks>
+		void Initialize(Buffer3 &) override
+		{
+			assert(buff && "GLVisualizer needs a BufferGL before use");
+			if (buff)
+				Initialize(*buff, simplex);
+		}
+
+		void Reserve(int polygons, int points) override
+		{
+			if (buff->IsIndexed())
+			{
+				buff->Reserve(simplex == SM_Point ? polygons : points);
+				buff->ReserveIndices(simplex == SM_Triangle ? 3 * (points - 2 * polygons) : points);
+				return;
+			}
+
+			switch (simplex)
+			{
+			case SM_Point:
+				buff->Reserve(polygons);
+				break;
+			case SM_Line:
+				buff->Reserve(points);
+				break;
+			default:
+				buff->Reserve(3 * (points - 2 * polygons));
+				break;
+			}
+		}
+
+		/// <summary>
+		/// Per-simplex visualize method
+		/// Assume Vector4[] is Vector3[] with w = 0 each
+		/// </summary>
+		void Render(const Vector4 *buffer, int count) override
+		{
+			if (buff->IsIndexed())
+			{
+				RenderShared(buffer, simplex == SM_Point ? 1 : count);
+				return;
+			}
+
+			switch (simplex)
+			{
+			case SM_Point:
+				Write(buff->Push(1), buffer[0]);
+				break;
+			case SM_Line:
+				for (int i = 0; i < count; i++)
+					Write(buff->Push(1), buffer[i]);
+				break;
+			default:
+				for (int i = 2; i < count; i++)
+					WriteTriangle(buffer[0], buffer[i - 1], buffer[i]);
+				break;
+			}
+		}
+
+		/// <summary>
+		/// Welded output is only taken when the buffer is indexed
+		/// </summary>
+		bool IsIndexed(void) const override { return buff->IsIndexed(); }
+
+		int Emit(const Vector4 &v) override
+		{
+			return buff->AddVertex(v.ToVec3());
+		}
+
+		void RenderIndexed(const int indices[], int count) override
+		{
+			if (simplex != SM_Triangle || !buff->HasNormals())
+			{
+				if (simplex == SM_Triangle)
+					for (int i = 2; i < count; i++)
+					{
+						buff->AddIndex(indices[0]);
+						buff->AddIndex(indices[i - 1]);
+						buff->AddIndex(indices[i]);
+					}
+				else
+					for (int i = 0; i < (simplex == SM_Point ? 1 : count); i++)
+						buff->AddIndex(indices[i]);
+				return;
+			}
+
+			Vector3 n = Vector3();
+			for (int i = 2; i < count; i++)
+				n = n + GetNormal(Position(indices[0]), Position(indices[i - 1]), Position(indices[i]));
+			buff->AddPolygon(indices, count, n);
+		}
+
+		/// <summary>
+		/// Pack indices and vertices once everything is in
+		/// </summary>
+		void End(void) override
+		{
+			buff->Pack();
+		}
+
+	  private:
+		inline Vector3 Position(int vertex) const
+		{
+			const float *f = buff->vb + vertex * buff->attr.stripe;
+			return Vector3(f[0], f[1], f[2]);
+		}
+
+		/// <summary>
+		/// Area weighted triangle normal, same orientation as BufferGL::FillNormals()
+		/// </summary>
+		static inline Vector3 GetNormal(const Vector3 &a, const Vector3 &b, const Vector3 &c)
+		{
+			return Cross(b - c, a - c);
+		}
+
+		/// <summary>
+		/// Unwelded polygon into an indexed buffer, its vertices owning the polygon's normal
+		/// </summary>
+		inline void RenderShared(const Vector4 *buffer, int count)
+		{
+			const int o = buff->attr.vertexs;
+			for (int i = 0; i < count; i++)
+				buff->AddVertex(buffer[i].ToVec3());
+
+			if (simplex != SM_Triangle)
+			{
+				for (int i = 0; i < count; i++)
+					buff->AddIndex(o + i);
+				return;
+			}
+
+			for (int i = 2; i < count; i++)
+			{
+				buff->AddIndex(o);
+				buff->AddIndex(o + i - 1);
+				buff->AddIndex(o + i);
+			}
+
+			if (buff->HasNormals())
+			{
+				Vector3 n = Vector3();
+				for (int i = 2; i < count; i++)
+					n = n + GetNormal(buffer[0].ToVec3(), buffer[i - 1].ToVec3(), buffer[i].ToVec3());
+				n = Normalize(n);
+
+				for (int i = 0; i < count; i++)
+				{
+					float *f = buff->vb + (o + i) * buff->attr.stripe;
+					f[3] = n.x;
+					f[4] = n.y;
+					f[5] = n.z;
+				}
+			}
+		}
+
+		static inline void Write(float *f, const Vector4 &v)
+		{
+			f[0] = v.x;
+			f[1] = v.y;
+			f[2] = v.z;
+		}
+
+		inline void WriteTriangle(const Vector4 &a, const Vector4 &b, const Vector4 &c)
+		{
+			const int stripe = buff->attr.stripe;
+			float *f = buff->Push(3);
+
+			Write(f, a);
+			Write(f + stripe, b);
+			Write(f + stripe * 2, c);
+
+			if (buff->HasNormals())
+			{
+				// Same flat normal as BufferGL::FillNormals()
+				const Vector3 av = a.ToVec3(), bv = b.ToVec3(), cv = c.ToVec3(),
+							  nv = Normalize(Cross(bv - cv, av - cv));
+
+				for (int j = 0; j < 3; ++j)
+				{
+					f[j * stripe + 3] = nv.x;
+					f[j * stripe + 4] = nv.y;
+					f[j * stripe + 5] = nv.z;
+				}
+			}
+		}
+	};
+} // namespace Forth
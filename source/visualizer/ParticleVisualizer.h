@@ -22,6 +22,11 @@ namespace Forth
 			buff->simplex = SimplexMode::SM_Point;
 		}
 
+		void Reserve(int polygons, int /*points*/) override
+		{
+			buff->Reserve(polygons, polygons);
+		}
+
 		/// <summary>
 		/// Per-simplex visualize method
 		/// Assume Vector4[] is Vector3[] with w = 0 each
@@ -32,6 +37,20 @@ namespace Forth
 			buff->AddTris((int)buff->vertices_count);
 			buff->AddVert(buffer[0].ToVec3());
 		}
+
+		bool IsIndexed(void) const override { return true; }
+
+		int Emit(const Vector4 &v) override
+		{
+			int o = buff->vertices_count;
+			buff->AddVert(v.ToVec3());
+			return o;
+		}
+
+		void RenderIndexed(const int indices[], int /*count*/) override
+		{
+			buff->AddTris(indices[0]);
+		}
 	};
 
 } // namespace Forth
\ No newline at end of file
@@ -12,22 +12,10 @@ namespace Forth
 		buff->simplex = SimplexMode::SM_Triangle;
 	}
 
-	void SolidVisualizer::Render(const Vector4 *buffer, int count)
-	{
-		Buffer3 &b = *buff;
-		int o = b.vertices_count;
-		b.AddVert(buffer[0].ToVec3());
-		b.AddVert(buffer[1].ToVec3());
-		for (int i = 2; i < count; i++)
-		{
-			b.AddVert(buffer[i].ToVec3());
-			b.AddTris(0 + o, i - 1 + o, i + o);
-		}
-	}
-
 	void SolidVisualizer::End()
 	{
-		// Not needed. Much easier to use double-sided shader instead.
+		// Not needed. Much easier to use double-sided shader instead,
+		// or CrossSection::orient for consistently wound sources.
 		// RefineTriangleOrder();
 	}
 
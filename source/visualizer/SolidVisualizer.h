@@ -16,11 +16,45 @@ namespace Forth
 		/// </summary>
 		void Initialize(Buffer3 &buffer) override;
 
+		void Reserve(int polygons, int points) override
+		{
+			buff->Reserve(points, 3 * (points - 2 * polygons));
+		}
+
 		/// <summary>
 		/// Per-simplex visualize method
 		/// Assume Vector4[] is Vector3[] with w = 0 each
 		/// </summary>
-		void Render(const Vector4 *buffer, int count) override;
+		void Render(const Vector4 *buffer, int count) override
+		{
+			Buffer3 &b = *buff;
+			int o = b.vertices_count;
+			b.AddVert(buffer[0].ToVec3());
+			b.AddVert(buffer[1].ToVec3());
+			for (int i = 2; i < count; i++)
+			{
+				b.AddVert(buffer[i].ToVec3());
+				b.AddTris(0 + o, i - 1 + o, i + o);
+			}
+		}
+
+		bool IsIndexed(void) const override { return true; }
+
+		int Emit(const Vector4 &v) override
+		{
+			int o = buff->vertices_count;
+			buff->AddVert(v.ToVec3());
+			return o;
+		}
+
+		/// <summary>
+		/// Per-simplex visualize method with shared vertices
+		/// </summary>
+		void RenderIndexed(const int indices[], int count) override
+		{
+			for (int i = 2; i < count; i++)
+				buff->AddTris(indices[0], indices[i - 1], indices[i]);
+		}
 
 		/// <summary>
 		/// Marks the end of the visualizing function
@@ -21,6 +21,11 @@ namespace Forth
 			buff->simplex = SimplexMode::SM_Line;
 		}
 
+		void Reserve(int /*polygons*/, int points) override
+		{
+			buff->Reserve(points, points);
+		}
+
 		/// <summary>
 		/// Per-simplex visualize method
 		/// Assume Vector4[] is Vector3[] with w = 0 each
@@ -34,5 +39,20 @@ namespace Forth
 				buff->AddVert(buffer[i].ToVec3());
 			}
 		}
+
+		bool IsIndexed(void) const override { return true; }
+
+		int Emit(const Vector4 &v) override
+		{
+			int o = buff->vertices_count;
+			buff->AddVert(v.ToVec3());
+			return o;
+		}
+
+		void RenderIndexed(const int indices[], int count) override
+		{
+			for (int i = 0; i < count; i++)
+				buff->AddTris(indices[i]);
+		}
 	};
 } // namespace Forth
\ No newline at end of file